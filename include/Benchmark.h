@@ -0,0 +1,176 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "ElementwiseKernels.h"
+#include "BufferPool.h"
+#include "IPCMethod.h"
+#include "ProcessCounters.h"
+#include "Topology.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sched.h>
+
+// command line configuration of a benchmark run
+struct BenchmarkConfig {
+    std::vector<std::string> transports; // methodName()s to run, empty = all
+    std::vector<int> sizes;              // matrix sizes (n for an n x n matrix)
+    torch::ScalarType dtype = MATRIX_DTYPE; // element type of the matrices
+    std::vector<MatrixOp> operations{OP_SQUARE}; // what the children compute, swept per cell
+    std::vector<double> densities{1.0};  // share of nonzero elements to sweep
+    double sparseThreshold = 0;          // encode matrices sparse below this density, 0 = never
+    bool compareEncodings = false;       // run every cell dense and sparse, to find the crossover
+    KernelIsa kernelCap = KERNEL_AVX512;  // widest instruction set the children's kernels may use
+    LaunchMode launch = LAUNCH_FORK;     // how transports start their children
+    bool perf = false;                   // also read perf_event_open counters of parent and children
+    int warmup = 5;                      // untimed requests per cell before measuring
+    int iterations = 100;                // timed requests per cell
+    int window = 1;                      // requests in flight; >1 pipelines them through submit()
+    int workers = 0;                     // >0: sweep worker pools of 1, 2, 4 .. workers children
+    int batch = 0;                       // >0: coalesce up to this many matrices per transfer
+    int batchDelayUs = 200;              // flush a partial batch after this long, 0 = never
+    int threads = 0;                     // >0: sweep 1, 2, 4 .. threads callers sharing each transport
+    uint64_t seed = 42;                  // seed for the matrix contents
+    std::vector<Placement> placements;   // cpu / NUMA placements to run every transport under
+    std::string csvPath;                 // write results as CSV when set
+    std::string jsonPath;                // write results as JSON when set
+};
+
+// one phase of the per-phase breakdown (IPC_ENABLE_PHASE_TIMING builds only)
+struct PhaseSummary {
+    std::string name;
+    uint64_t count = 0;
+    double meanUs = 0, p50Us = 0, p99Us = 0;
+};
+
+// one perf_event_open counter of a cell, per request; -1 where the kernel doesn't expose it
+struct PerfCount {
+    std::string name;                    // perfEventName()
+    double parent = -1;                  // the benchmark thread
+    double children = -1;                // the serving threads of all children
+};
+
+// start-up cost of one transport run: how long until its children were up and answering,
+// and how much memory each of them holds
+struct LaunchSample {
+    std::string transport;
+    int workers = 1;
+    int batch = 0;
+    int threads = 1;
+    std::string placement;
+    std::string mode = "fork";           // launchModeName() actually used; spawn falls back to fork
+    double launchUs = 0;                 // initSubprocess
+    double firstResponseUs = 0;          // initSubprocess until the first result is back
+    double childRssKb = 0;               // resident set per child after the first result (VmRSS)
+    double childPeakRssKb = 0;           // peak resident set per child over the run (VmHWM)
+};
+
+// latency distribution and throughput of one (transport, size) cell
+struct BenchmarkCell {
+    std::string transport;
+    int size = 0;
+    std::string dtype;                   // wireDtypeName() of the matrices
+    std::string op = "square";           // MatrixOpInfo::name of what the child computed
+    double intensity = 0;                // flops per byte moved (request and result, dense)
+    double density = 1;                  // share of nonzero elements
+    std::string encoding = "dense";      // dense, sparse (whenever smaller) or auto (below a threshold)
+    size_t bytes = 0;                    // payload bytes per request, one direction
+    size_t resultBytes = 0;              // payload bytes per result (differs for non-elementwise ops)
+    int iterations = 0;
+    int errors = 0;                      // results that failed verification
+    double minUs = 0, p50Us = 0, p90Us = 0, p99Us = 0, p999Us = 0, maxUs = 0, meanUs = 0;
+    double mbps = 0;                     // bytes / p50 latency
+    double aggregateMbps = 0;            // bytes of all timed requests / time they took
+    int window = 1;                      // requests that were kept in flight
+    int workers = 1;                     // child processes serving the requests
+    int batch = 0;                       // matrices coalesced per transfer, 0 = not batched
+    int threads = 1;                     // caller threads sharing the transport
+    double requestsPerSecond = 0;        // timed requests of all callers / time they took
+    std::string placement;               // Placement::describe() of the run
+    double minorFaults = 0;              // parent page faults per request
+    double majorFaults = 0;
+    double parentSwitches = 0;           // parent context switches per request, voluntary + involuntary
+    double childMinorFaults = 0;         // page faults of all children per request
+    double childMajorFaults = 0;
+    double childSwitches = 0;            // context switches of the children's serving threads per request
+    double parentRssKb = 0;              // resident set at the end of the cell
+    double childrenRssKb = 0;            // of all children together
+    double poolRequests = 0;             // parent BufferPool tensors handed out per request
+    double poolAllocations = 0;          // ... of them freshly allocated (new mapping or oversize)
+    double poolCachedKb = 0;             // parent BufferPool free lists at the end of the cell
+    std::vector<PerfCount> perf;         // every PerfEvent with --perf, empty otherwise
+    double parentCpuUs = 0;              // parent cpu time per request, all threads
+    double childCpuUs = 0;               // cpu time of all children per request
+    std::string launch = "fork";         // how the children of this run were started
+    double launchUs = 0;                 // LaunchSample of the run
+    double firstResponseUs = 0;
+    double childRssKb = 0;
+    double childPeakRssKb = 0;
+    std::vector<PhaseSummary> phases;    // empty unless built with phase timing
+};
+
+class Benchmark {
+public:
+    explicit Benchmark(const BenchmarkConfig& config) : config(config) {}
+
+    // parse argv; prints usage and exits on --help or malformed input
+    static BenchmarkConfig parseArguments(int argc, char** argv);
+
+    // geometric sweep from minSize to maxSize (both included), multiplying by factor
+    static std::vector<int> geometricSizes(int minSize, int maxSize, double factor);
+
+    void run();
+    void printSummary() const;
+    void writeCsv(const std::string& path) const;
+    void writeJson(const std::string& path) const;
+
+    const std::vector<BenchmarkCell>& results() const { return cells; }
+
+private:
+    BenchmarkConfig config;
+    std::vector<BenchmarkCell> cells;
+    std::vector<LaunchSample> launches;  // one per transport run
+    cpu_set_t unpinnedAffinity;          // the parent's mask before any placement, for unpinned children
+    struct {
+        double parentUs = 0;
+        double childUs = 0;
+    } cpuSample;                         // cpu times at the start of the timed phase
+    // counters of both sides, cumulative; sampled around every timed request of the
+    // synchronous path and around the whole timed phase of the pipelined one
+    struct UsageSample {
+        ProcessCounters parent;
+        ProcessCounters children;
+        BufferPoolStats pool;            // the parent's
+        std::vector<double> parentPerf;  // PerfCounters::read(), empty without --perf
+        std::vector<double> childPerf;
+    };
+    std::unique_ptr<PerfCounters> parentPerf; // --perf, while a transport runs
+    std::unique_ptr<PerfCounters> childPerf;
+
+    void runBatched(std::unique_ptr<IPCMethod> method, int workers, int threads, int window, const Placement& placement);
+    void runTransport(IPCMethod& method, int workers, int threads, int window, const Placement& placement);
+    void pinChildren(IPCMethod& method, const Placement& placement) const;
+    BenchmarkCell runCell(IPCMethod& method, int size, int threads, int window, double density);
+    void runPipelined(IPCMethod& method, int size, int window, double density, BenchmarkCell& cell,
+                      std::vector<double>& latencies, UsageSample& usage, double& timedSeconds);
+    void runConcurrent(IPCMethod& method, int size, int threads, double density, BenchmarkCell& cell,
+                       std::vector<double>& latencies, UsageSample& usage, double& timedSeconds);
+    void printCell(const BenchmarkCell& cell, const Placement& placement, bool showDensity) const;
+    bool showOperation() const;
+    torch::Tensor prepareMatrix(IPCMethod& method, int size, double density) const;
+    void printCrossover() const;
+    void printIntensity() const;
+    void printLaunches() const;
+    void printCallerScaling() const;
+    LaunchSample launchTransport(IPCMethod& method, int workers, int threads, const Placement& placement);
+    static std::vector<int> scalingSweep(int maxCount);
+    void startCpuSample(IPCMethod& method);
+    void finishCpuSample(IPCMethod& method, BenchmarkCell& cell);
+    UsageSample sampleUsage(IPCMethod& method) const;
+    static void addUsage(UsageSample& total, const UsageSample& before, const UsageSample& after);
+    void finishUsage(IPCMethod& method, const UsageSample& total, size_t requests, BenchmarkCell& cell) const;
+    static double percentile(const std::vector<double>& sorted, double p);
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,29 @@
+#ifndef ELEMENTWISEKERNELS_H
+#define ELEMENTWISEKERNELS_H
+
+#include <cstdint>
+#include <string>
+
+// instruction sets the elementwise kernels are built for, in increasing order. each kernel is
+// compiled for all of them with target attributes and picked at runtime from what the cpu
+// supports, so the binary still runs on a cpu without AVX
+enum KernelIsa {
+    KERNEL_SCALAR = 0,
+    KERNEL_SSE2,
+    KERNEL_AVX2,
+    KERNEL_AVX512,
+    KERNEL_ISA_COUNT
+};
+
+KernelIsa supportedKernelIsa();          // best one this cpu has (CPUID, checked once)
+KernelIsa kernelIsa();                   // the one in use: supported, capped by setKernelIsa
+void setKernelIsa(KernelIsa cap);        // inherited by children forked afterwards
+const char* kernelIsaName(KernelIsa isa);
+bool parseKernelIsa(const std::string& name, KernelIsa& isa);
+
+// out[i] = in[i] * in[i] for count elements of a wire dtype, straight on the transport
+// buffer; in == out squares in place. float32, float64, int32 and int16 have vector kernels,
+// the other dtypes a scalar loop
+void squareElements(const void* in, void* out, int64_t count, uint8_t dtype);
+
+#endif // ELEMENTWISEKERNELS_H
@@ -0,0 +1,62 @@
+#ifndef ASYNCCOMPLETIONS_H
+#define ASYNCCOMPLETIONS_H
+
+#include <torch/torch.h>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+
+// bookkeeping for pipelined requests on one transport. every submitted request gets an id
+// that travels with it through the channel and comes back with its result; a completion
+// thread reads results as they arrive and fulfils the matching promise. the thread only
+// runs while requests are outstanding, so the synchronous path can use the channel after
+// drain() without racing it.
+class AsyncCompletions {
+public:
+    // reads exactly one result off the channel and hands it to complete()
+    using ReceiveFn = std::function<void()>;
+
+    ~AsyncCompletions();
+
+    // register a new request, blocking while 'window' requests are already outstanding.
+    // 'buffer' is kept alive until the request completes: the input for transports that
+    // send straight from the caller's storage, or the preallocated result.
+    uint64_t begin(std::future<torch::Tensor>& future, const torch::Tensor& buffer,
+                   size_t window, const ReceiveFn& receiveOne);
+
+    // called from the completion thread once the result of 'requestId' is in
+    void complete(uint64_t requestId, const torch::Tensor& result);
+
+    // the buffer registered with a request that is still outstanding
+    torch::Tensor buffer(uint64_t requestId);
+    // phaseClockNs() at the time the request was registered
+    uint64_t submittedNs(uint64_t requestId);
+
+    // wait until every outstanding request has completed and stop the completion thread
+    void drain();
+
+    size_t inFlight();
+
+private:
+    struct Request {
+        std::promise<torch::Tensor> promise;
+        torch::Tensor buffer;
+        uint64_t submittedNs;
+    };
+
+    std::mutex mutex;
+    std::condition_variable changed;        // a request was added or completed, or stopping
+    std::map<uint64_t, Request> requests;   // outstanding requests by id
+    uint64_t nextId = 1;
+    bool stopping = false;
+    std::thread completionThread;
+
+    void completionLoop(ReceiveFn receiveOne);
+    Request& find(uint64_t requestId);      // mutex must be held
+};
+
+#endif // ASYNCCOMPLETIONS_H
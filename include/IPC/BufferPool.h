@@ -0,0 +1,56 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <torch/torch.h>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// buffer counts of a pool, cumulative except cachedBytes
+struct BufferPoolStats {
+    uint64_t requests = 0;  // tensors handed out
+    uint64_t reused = 0;    // ... from a free list, no allocation and no fault
+    uint64_t allocated = 0; // ... from a fresh, pre-faulted mapping
+    uint64_t oversize = 0;  // ... above the largest class: torch::empty, not pooled
+    uint64_t released = 0;  // buffers given back to the system because their free list was full
+    size_t cachedBytes = 0; // on the free lists now
+};
+
+// power of two size classes of page aligned buffers that are faulted in when mapped and kept
+// on a free list when their tensor goes away, so receiving the same sizes over and over
+// neither calls the allocator nor takes page faults. one pool per process, shared by every
+// transport. the buffers are wiped in a forked child, which starts with empty free lists, so
+// a fork doesn't turn the parent's cached buffers copy on write. pooled tensors the parent
+// holds at the fork read as zeros in the child
+class BufferPool {
+public:
+    static BufferPool& instance();
+
+    torch::Tensor empty(at::IntArrayRef sizes, torch::ScalarType dtype);
+    // sizes and strides must describe a non-overlapping, dense layout
+    torch::Tensor emptyStrided(at::IntArrayRef sizes, at::IntArrayRef strides, torch::ScalarType dtype);
+
+    BufferPoolStats stats() const;
+    void trim(); // unmap every cached buffer; a forked child does this right away
+
+private:
+    BufferPool();
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    static const int MIN_CLASS_SHIFT = 12; // 4 KiB
+    static const int MAX_CLASS_SHIFT = 28; // 256 MiB
+    static const int CLASS_COUNT = MAX_CLASS_SHIFT - MIN_CLASS_SHIFT + 1;
+
+    mutable std::mutex mutex;
+    std::vector<void*> freeLists[CLASS_COUNT];
+    BufferPoolStats counts;
+
+    torch::Tensor acquire(size_t bytes, at::IntArrayRef sizes, at::IntArrayRef strides, torch::ScalarType dtype);
+    void release(void* buffer, int sizeClass);
+    static size_t classBytes(int sizeClass) { return size_t(1) << (sizeClass + MIN_CLASS_SHIFT); }
+    static size_t classCapacity(int sizeClass); // buffers a free list keeps
+};
+
+#endif // BUFFERPOOL_H
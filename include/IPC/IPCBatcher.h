@@ -0,0 +1,94 @@
+#ifndef IPCBATCHER_H
+#define IPCBATCHER_H
+
+#include "IPCMethod.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// when a batch of small matrices goes out
+struct BatchPolicy {
+    size_t maxTensors = 64;                        // flush once this many matrices are pending
+    size_t maxBytes = 256 * 1024;                  // ... or their payload reaches this many bytes
+    std::chrono::microseconds maxDelay{200};       // ... or the oldest has waited this long; 0 = never
+};
+
+// coalesces small matrices into one request on an inner transport. pending matrices are
+// packed back to back into a square carrier matrix of their dtype, which the child processes
+// in one go; a shape table (offset, shape per matrix) splits the result into views again.
+// only elementwise ops are batched, so the child needs no shapes and the table stays on this side.
+// a matrix of another dtype than the pending ones flushes them first.
+class IPCBatcher : public IPCMethod {
+public:
+    IPCBatcher(std::unique_ptr<IPCMethod> inner, BatchPolicy policy = BatchPolicy());
+    ~IPCBatcher() override;
+    std::string methodName() const override { return inner->methodName(); }
+
+    void initSubprocess() override;               // also starts the deadline thread
+    void exitSubprocess() override;               // flushes and waits for every batch first
+    torch::Tensor sendAndReceiveV2(const torch::Tensor& matrix) override; // flushes at once
+    std::future<torch::Tensor> submit(const torch::Tensor& matrix) override;
+    size_t outstandingRequests() override;
+    std::vector<pid_t> workerPids() const override { return inner->workerPids(); }
+    // the carrier mixes matrices, so the op must be elementwise
+    bool supportsOperation(MatrixOp op) const override {
+        return MatrixOperation::operation(op).elementwise() && inner->supportsOperation(op);
+    }
+    void setOperation(MatrixOp op) override;      // pending matrices go out under the old op first
+    void setLaunchMode(LaunchMode mode) override {
+        IPCMethod::setLaunchMode(mode);
+        inner->setLaunchMode(mode);
+    }
+    bool supportsSpawn() const override { return inner->supportsSpawn(); }
+    // the carrier is what gets encoded, so the zero tail counts towards its density
+    void setSparseThreshold(double density) override {
+        IPCMethod::setSparseThreshold(density);
+        inner->setSparseThreshold(density);
+    }
+
+    // phases are those of the carrier requests
+    const PhaseStats& phaseStats() const override { return inner->phaseStats(); }
+    void resetPhaseStats() override { inner->resetPhaseStats(); }
+
+    void flush();                                 // send whatever is pending now
+
+private:
+    struct ShapeEntry {
+        uint64_t offset;                          // first element in the carrier
+        std::vector<int64_t> shape;
+    };
+    struct Batch {
+        std::vector<torch::Tensor> inputs;        // until packed
+        std::vector<ShapeEntry> shapes;
+        std::vector<std::promise<torch::Tensor>> promises;
+        size_t bytes = 0;
+        torch::ScalarType dtype = MATRIX_DTYPE;
+        std::chrono::steady_clock::time_point deadline;
+        std::future<torch::Tensor> result;        // carrier result from the inner transport
+    };
+
+    std::unique_ptr<IPCMethod> inner;
+    BatchPolicy policy;
+
+    std::mutex mutex;
+    std::condition_variable changed;              // matrices pending, batch done, or stopping
+    Batch pending;
+    std::deque<Batch> inFlight;                   // in submission order
+    size_t outstanding = 0;                       // matrices submitted and not completed
+    bool stopping = false;
+    std::thread flushThread;                      // deadline flushes, splits results
+    std::mutex submitMutex;                       // one inner submit at a time, in inFlight order
+
+    void flushLocked(std::unique_lock<std::mutex>& lock);
+    torch::Tensor pack(Batch& batch);
+    void complete(Batch& batch);
+    void flushLoop();
+    void stopFlushThread();
+};
+
+#endif // IPCBATCHER_H
@@ -0,0 +1,74 @@
+#ifndef IPCCROSSMEMORY_H
+#define IPCCROSSMEMORY_H
+
+#include "IPCMethod.h"
+#include "AsyncCompletions.h"
+#include "TensorWire.h"
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+enum CrossMemoryCommand : int32_t {
+    CMA_PROCESS = 1, // the descriptor names a request in the parent's memory
+    CMA_EXIT = 2
+};
+
+// request descriptor on the request pipe; the payload itself stays in the parent. smaller
+// than PIPE_BUF, so every write is atomic
+struct CrossMemoryRequest {
+    int32_t command;
+    int32_t reserved;
+    uint64_t requestId;
+    uint64_t source;          // address of the dense request payload in the parent
+    uint64_t target;          // address of the preallocated result in the parent
+    uint64_t targetBytes;     // its capacity
+    TensorWireHeader header;  // of the request, with the op
+};
+
+// answer on the response pipe, once the result is in the parent's memory
+struct CrossMemoryResponse {
+    uint64_t requestId;
+    int32_t error;            // errno of a failed transfer, 0 on success
+    int32_t reserved;
+    TensorWireHeader header;  // of the result
+};
+
+// Cross Memory Attach: only descriptors travel over a pipe. the child pulls the request
+// straight out of the parent's address space with process_vm_readv and pushes the result
+// into a buffer the parent preallocated with process_vm_writev, one copy per direction and
+// no shared segment to size. payloads are always dense; the parent keeps both buffers alive
+// until the result is back. under Yama ptrace_scope 1 the parent names the child its ptracer.
+class IPCCrossMemory : public IPCMethod {
+public:
+    IPCCrossMemory();
+    ~IPCCrossMemory() override;
+    std::string methodName() const override { return "CrossMemory"; }
+
+    void initSubprocess() override;
+    void exitSubprocess() override;
+    torch::Tensor sendAndReceiveV2(const torch::Tensor& matrix) override;
+    std::future<torch::Tensor> submit(const torch::Tensor& matrix) override;
+    std::vector<pid_t> workerPids() const override { return childPid > 0 ? std::vector<pid_t>{childPid} : std::vector<pid_t>{}; }
+    size_t outstandingRequests() override { return completions.inFlight(); }
+    // a spawned worker inherits the child's ends of both pipes
+    bool supportsSpawn() const override { return true; }
+    void serveWorker(const ChannelArguments& args) override;
+
+private:
+    int requestPipe[2];       // descriptors, parent to child
+    int responsePipe[2];      // responses, child to parent
+    pid_t childPid = -1;
+    AsyncCompletions completions; // results preallocated by submit() and still due
+    std::mutex sentMutex;
+    std::deque<torch::Tensor> sentRequests; // payloads the child may still read, in order
+
+    void allowChildAccess();
+    void revokeChildAccess();    // after the child is reaped
+    torch::Tensor prepareRequest(const torch::Tensor& matrix, TensorWireHeader& header, torch::Tensor& result) const;
+    void sendRequest(const torch::Tensor& payload, const TensorWireHeader& header, const torch::Tensor& result, uint64_t requestId);
+    CrossMemoryResponse receiveResponse(PhaseTimes& childTimes); // exits if the child's transfer failed
+    void completeOneRequest();  // completion thread
+    void serveRequests();       // child loop, until CMA_EXIT or the parent going away
+};
+
+#endif // IPCCROSSMEMORY_H
@@ -0,0 +1,15 @@
+#ifndef IPCFACTORY_H
+#define IPCFACTORY_H
+
+#include "IPCMethod.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// names accepted by createIPCMethod, in the order the benchmark runs them by default
+std::vector<std::string> availableIPCMethods();
+
+// construct the transport registered under 'name' (its methodName()); nullptr if unknown
+std::unique_ptr<IPCMethod> createIPCMethod(const std::string& name);
+
+#endif // IPCFACTORY_H
@@ -1,26 +1,103 @@
 #ifndef IPCMETHOD_H
 #define IPCMETHOD_H
 
+#include <future>
 #include <string>
+#include <vector>
+#include <sys/types.h>
 #include <torch/torch.h>
 
 #include "debug.h"
+#include "MatrixOperation.h"
+#include "PhaseTimer.h"
+#include "TensorWire.h"
+#include "WorkerLauncher.h"
 
+// default element type of the benchmark matrices; transports carry any type TensorWire.h
+// knows at its native width
 // for C++ standard library containers
 #define CPP_TENSOR_DTYPE float
 
 // for PyTorch tensors
 #define MATRIX_DTYPE torch::kFloat32
 
+// an instance serves one caller thread at a time; IPCSubmissionQueue shares one between threads
 class IPCMethod {
 public:
     virtual ~IPCMethod() {}
     virtual void initSubprocess() = 0; // to setup communication channel and fork
     virtual void exitSubprocess() = 0; // to close communication channel and exit
-    virtual void sendAndReceive(int matrixSize) = 0;
+    // one-shot version kept for interface compatibility: start the child, send one random
+    // matrix under operation(), verify and print the result, tear down
+    virtual void sendAndReceive(int matrixSize);
     virtual torch::Tensor sendAndReceiveV2(const torch::Tensor& matrix) = 0;
     virtual std::string methodName() const = 0;
 
+    // allocate a matrix that this method can send with the fewest copies; transports that
+    // own memory visible to the child override this to hand out tensors living there
+    virtual torch::Tensor allocateMatrix(int rows, int cols, torch::ScalarType dtype = MATRIX_DTYPE) {
+        return torch::empty({rows, cols}, dtype);
+    }
+
+    // queue a matrix and return without waiting for its result, so the channel and the child
+    // stay busy while the caller prepares the next one. at most maxInFlight() requests are
+    // outstanding; submit blocks while the window is full. transports without a pipelined
+    // path answer synchronously.
+    virtual std::future<torch::Tensor> submit(const torch::Tensor& matrix) {
+        std::promise<torch::Tensor> promise;
+        promise.set_value(sendAndReceiveV2(matrix));
+        return promise.get_future();
+    }
+    virtual void setMaxInFlight(size_t window) { inFlightWindow = window > 0 ? window : 1; }
+    size_t maxInFlight() const { return inFlightWindow; }
+
+    // matrices whose estimated density is below this go out CSR/COO encoded (TensorWire.h)
+    // where the transport supports it; 0 always sends them dense
+    virtual void setSparseThreshold(double density) { sparseDensity = density; }
+    double sparseThreshold() const { return sparseDensity; }
+
+    // operation the children apply to the requests sent from now on; it travels in the
+    // header of every request. transports whose child only ever holds part of a matrix (a
+    // batch, a slot, a chunk) run elementwise ops only
+    virtual void setOperation(MatrixOp op) { matrixOp = op; }
+    MatrixOp operation() const { return matrixOp; }
+    virtual bool supportsOperation(MatrixOp op) const { return true; }
+
+    // how initSubprocess starts the child (WorkerLauncher.h). transports that can hand their
+    // channel to a separate process support spawn; the others keep forking
+    virtual void setLaunchMode(LaunchMode mode) { launch = mode; }
+    virtual bool supportsSpawn() const { return false; }
+    bool spawnsWorker() const { return launch == LAUNCH_SPAWN && supportsSpawn(); }
+    LaunchMode launchMode() const { return spawnsWorker() ? LAUNCH_SPAWN : LAUNCH_FORK; }
+
+    // IPCWorker side of spawn: attach to the channel the parent described in args, in place
+    // of the one the constructor set up, and serve it until the parent says exit
+    virtual void serveWorker(const ChannelArguments& args); // exits unless overridden
+
+    // pids of the child processes serving this method, for per-process cpu accounting
+    virtual std::vector<pid_t> workerPids() const { return {}; }
+
+    // requests submitted but not yet completed; worker pools dispatch on this
+    virtual size_t outstandingRequests() { return 0; }
+
+    // per-phase latency histograms of the requests sent so far (parent and child phases);
+    // only filled when built with IPC_ENABLE_PHASE_TIMING, an empty stub otherwise
+    virtual const PhaseStats& phaseStats() const { return phases; }
+    virtual void resetPhaseStats() { phases.clear(); }
+
+    // name for a named kernel object (semaphore, shm segment) that no other channel uses,
+    // so several instances of a transport can run side by side
+    static std::string uniqueChannelName(const std::string& prefix);
+
+protected:
+    PhaseStats phases;
+    size_t inFlightWindow = 8;
+    double sparseDensity = 0;
+    MatrixOp matrixOp = OP_SQUARE;
+    LaunchMode launch = LAUNCH_FORK;
+
+    // payload and header of a request: encoded as sparseThreshold() says, tagged with the op
+    torch::Tensor encodeRequest(const torch::Tensor& matrix, TensorWireHeader& header) const;
 };
 
 #endif
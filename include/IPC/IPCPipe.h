@@ -2,30 +2,78 @@
 #define IPCPIPE_H
 
 #include "IPCMethod.h"
+#include "AsyncCompletions.h"
+#include "IoUring.h"
+#include "TensorWire.h"
+#include <cstdint>
+
+enum PipeCommand : int32_t {
+    PIPE_PROCESS = 1, // a matrix follows on the request data pipe
+    PIPE_EXIT = 2
+};
+
+// fixed size message on the control pipe. it is smaller than PIPE_BUF, so every write is
+// atomic and back to back requests can't run into each other
+struct PipeControlMessage {
+    int32_t command;
+    int32_t reserved;
+    uint64_t requestId; // echoed in front of the result on the response data pipe
+};
 
 class IPCPipe : public IPCMethod {
 public:
-    IPCPipe();
+    // useSplice moves tensor pages into the pipe with vmsplice instead of writing them; every
+    // mode reads straight into a pooled tensor. pipeCapacity (bytes) grows the data pipes with F_SETPIPE_SZ, 0 keeps the default.
+    // ioUring moves the same frames through io_uring instead of read/write (not with useSplice).
+    // streaming has the child process and return each chunk as it arrives instead of the whole
+    // matrix after it arrived (plain read/write only, elementwise ops only)
+    IPCPipe(bool useSplice = false, int pipeCapacity = 0, IoUringMode ioUring = IO_URING_OFF, bool streaming = false);
     ~IPCPipe() override;
     void sendAndReceive(int matrixSize) override;
-    std::string methodName() const override { return "Pipe"; }
+    std::string methodName() const override;
 
     void initSubprocess() override;
     void exitSubprocess() override;
     torch::Tensor sendAndReceiveV2(const torch::Tensor& matrix) override;
-    void setMatrixSize(int matrixSize);
+    std::future<torch::Tensor> submit(const torch::Tensor& matrix) override;
+    std::vector<pid_t> workerPids() const override { return childPid > 0 ? std::vector<pid_t>{childPid} : std::vector<pid_t>{}; }
+    size_t outstandingRequests() override { return completions.inFlight(); }
+    bool supportsOperation(MatrixOp op) const override {
+        return !streaming || MatrixOperation::operation(op).elementwise();
+    }
+    // a spawned worker inherits the child's ends of the three pipes
+    bool supportsSpawn() const override { return true; }
+    void serveWorker(const ChannelArguments& args) override;
     
 private:
-    int matrixSize = 4; // use same varaible to communicate matrix size (can use separate pipe for this too)
     int dataPipe[2][2]; // pipe for matrix data: [0] is read end, [1] is write end
     int controlPipe[2]; // control pipe: [0] is read end, [1] is write end
     pid_t childPid = -1;  // PID of the child process
-    
-    std::string readFromControlPipe();
-    void writeToControlPipe(const char* msg, int matrixSize = -1);
+    bool useSplice;       // vmsplice mode instead of PIPE_BUF sized write copies
+    bool streaming;       // child works chunk by chunk; requests always go through submit()
+    torch::Tensor streamChunk; // child: the one chunk in flight through it
+    AsyncCompletions completions; // requests sent by submit() whose results are still due
+    IoUringMode ioUringMode;
+    IoUring sendRing;     // used by the thread that sends requests (child: results)
+    IoUring receiveRing;  // used by the thread that reads results (child: requests)
+
+    bool readFromControlPipe(PipeControlMessage& message);
+    void writeToControlPipe(PipeCommand command, uint64_t requestId = 0);
+    void sendRequest(const torch::Tensor& payload, const TensorWireHeader& header, uint64_t requestId);
+    uint64_t receiveResult(torch::Tensor& result, PhaseTimes& childTimes); // decoded
+    void completeOneRequest(); // completion thread
+    void serveRequests();      // child loop, until PIPE_EXIT or the parent going away
+    void streamApply(uint64_t requestId); // child: apply the op to one request chunk by chunk
 
-    void writeMatrixToPipe(int fd, const torch::Tensor &matrix);
-    void readMatrixFromPipe(int fd, torch::Tensor &matrix, int matrixSize);
+    // payloads go out under the given header and come back with the header they were sent
+    // under, still encoded
+    void writeMatrixToPipe(int fd, const torch::Tensor &payload, const TensorWireHeader& header);
+    TensorWireHeader readMatrixFromPipe(int fd, torch::Tensor &matrix);
+    void setPipeCapacity(int fd, int capacity);
+    void spliceMatrixToPipe(int fd, const torch::Tensor &payload, const TensorWireHeader& header, bool gift);
+    void setupIoUring(const std::vector<int>& sendFds, const std::vector<int>& receiveFds);
+    void writeMatrixIoUring(int fd, const torch::Tensor &payload, const TensorWireHeader& header);
+    TensorWireHeader readMatrixIoUring(int fd, torch::Tensor &matrix, bool staged);
 };
 
 #endif
\ No newline at end of file
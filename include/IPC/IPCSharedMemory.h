@@ -2,32 +2,71 @@
 #define IPCSHAREDMEMORY_H
 
 #include "IPCMethod.h"
+#include "WaitStrategy.h"
 #include <string>
+#include <vector>
 #include <semaphore.h>
 
 class IPCSharedMemory : public IPCMethod {
 public:
-    IPCSharedMemory();
+    // persistentMapping maps the segment once in initSubprocess (pre-faulted and locked)
+    // instead of on every request; hugePages additionally backs it with huge pages and
+    // implies persistentMapping. waitStrategy picks how each side waits for the other.
+    IPCSharedMemory(bool persistentMapping = false, bool hugePages = false,
+                    WaitStrategy waitStrategy = WAIT_SEMAPHORE);
     ~IPCSharedMemory() override;
     void sendAndReceive(int matrixSize) override;
-    std::string methodName() const override {return "SharedMemory";};
+    std::string methodName() const override;
 
     void initSubprocess() override;
     torch::Tensor sendAndReceiveV2(const torch::Tensor& matrix) override;
     void exitSubprocess() override;
+    std::vector<pid_t> workerPids() const override { return childPid > 0 ? std::vector<pid_t>{childPid} : std::vector<pid_t>{}; }
+    // the child sees one batch at a time
+    bool supportsOperation(MatrixOp op) const override { return MatrixOperation::operation(op).elementwise(); }
 
 private:
     int shmFd = -1;                                   // file descriptor for the shared memory object
     void* shmAddr = nullptr;                          // pointer to the shared memory object
-    off_t shmSize = 128*128*sizeof(CPP_TENSOR_DTYPE); // size of the shared memory segment
-    const char* shmName = "/dv_ipc_shared_mem";       // name of the shared memory object
+    off_t shmSize = 128*128*sizeof(CPP_TENSOR_DTYPE); // size of the shared memory segment used per batch
+    off_t mapSize = shmSize;                          // length actually mapped (rounded up for huge pages)
+    std::string shmName;                              // name of the shared memory object, unique per channel
     pid_t childPid = -1;
 
-    // Semaphores for synchronization
+    bool persistentMapping;                           // map once in initSubprocess and keep it mapped
+    bool hugePages;                                   // back the segment with huge pages
+    bool usingHugetlb = false;                        // hugetlbfs memfd worked, no THP fallback needed
+
+    // Semaphores for synchronization, named uniquely per channel
+    std::string semParentToChildName;
+    std::string semChildToParentName;
+    std::string semExitName;
     sem_t* sem_parent_to_child;                       // Semaphore for parent-to-child signaling
     sem_t* sem_child_to_parent;                       // Semaphore for child-to-parent signaling
     sem_t* sem_exit;                                  // semaphore for signaling exit
 
+    // WAIT_BUSY_POLL / WAIT_SPIN_FUTEX: [0] parent -> child, [1] child -> parent, in a
+    // shared anonymous page that stays mapped for the whole lifetime of the channel
+    WaitStrategy waitStrategy;
+    SharedSignal* signals = nullptr;
+    int spinBudget = 0;                               // this process' adaptive spin budget
+
+    // WAIT_EVENTFD / WAIT_EVENTFD_EPOLL: same directions as eventfds inherited across fork;
+    // with epoll every process waits through its own epoll set holding the fd it waits on
+    EventSignal events[2];
+    int epollFd = -1;
+
+    bool usesEventfd() const { return waitStrategy == WAIT_EVENTFD || waitStrategy == WAIT_EVENTFD_EPOLL; }
+    void setupEpoll(int direction);
+    void signalChild();
+    void waitForParent();
+    void signalParent();
+    void waitForChild();
+    void postTo(int direction);
+    void waitOn(int direction);
+
+    void createHugePageSegment();
+    void mapSegment();
     torch::Tensor writeMatrixInBatchesAndReadBack(const torch::Tensor& matrix);
     bool processMatrixInBatches();
 
@@ -0,0 +1,62 @@
+#ifndef IPCSHAREDMEMORYARENA_H
+#define IPCSHAREDMEMORYARENA_H
+
+#include "IPCMethod.h"
+#include "SharedTensorArena.h"
+#include "TensorWire.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <semaphore.h>
+
+// request descriptor placed in the first page of the arena segment; tensors are referred
+// to by their offset into the arena so the payload itself never moves
+struct ArenaRequest {
+    int64_t inputOffset;
+    int64_t outputOffset;
+    TensorWireHeader input;  // dtype, shape and strides of the block at inputOffset
+    TensorWireHeader output;
+    int32_t exit;
+#ifdef IPC_ENABLE_PHASE_TIMING
+    PhaseTimes childTimes; // filled by the child for each request
+#endif
+};
+
+class IPCSharedMemoryArena : public IPCMethod {
+public:
+    IPCSharedMemoryArena(size_t arenaBytes = 64 * 1024 * 1024);
+    ~IPCSharedMemoryArena() override;
+    std::string methodName() const override { return "SharedMemoryArena"; }
+
+    void initSubprocess() override;
+    torch::Tensor sendAndReceiveV2(const torch::Tensor& matrix) override;
+    void exitSubprocess() override;
+    std::vector<pid_t> workerPids() const override { return childPid > 0 ? std::vector<pid_t>{childPid} : std::vector<pid_t>{}; }
+    // a spawned worker opens the segment and both semaphores by name
+    bool supportsSpawn() const override { return true; }
+    void serveWorker(const ChannelArguments& args) override;
+
+    // matrices allocated here are squared by the child without being copied
+    torch::Tensor allocateMatrix(int rows, int cols, torch::ScalarType dtype = MATRIX_DTYPE) override;
+
+private:
+    int shmFd = -1;                                // file descriptor for the shared memory object
+    void* shmAddr = nullptr;                       // start of the mapped segment
+    size_t shmSize = 0;                            // request page + arena
+    std::string shmName;                           // name of the shared memory object, unique per channel
+    std::string semRequestName;
+    std::string semResponseName;
+    pid_t childPid = -1;
+
+    ArenaRequest* request = nullptr;               // inside the segment
+    char* arenaBase = nullptr;                     // inside the segment
+    std::unique_ptr<SharedTensorArena> arena;      // parent side allocator
+
+    sem_t* sem_request;                            // parent -> child: request ready
+    sem_t* sem_response;                           // child -> parent: result ready
+
+    torch::Tensor allocateOrDie(at::IntArrayRef sizes, torch::ScalarType dtype);
+    void serveRequests();                          // child loop
+};
+
+#endif // IPCSHAREDMEMORYARENA_H
@@ -0,0 +1,78 @@
+#ifndef IPCSHAREDMEMORYRING_H
+#define IPCSHAREDMEMORYRING_H
+
+#include "IPCMethod.h"
+#include "AsyncCompletions.h"
+#include "TensorWire.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// size of a cache line; every ring index gets its own line so the parent and child never
+// write to the same line
+#define RING_CACHE_LINE 64
+
+// control block at the start of the shared segment. each index has exactly one writer:
+// head is advanced by the parent (slot filled), processed by the child (op applied)
+// and tail by the parent (slot copied back), so no locks are needed.
+struct RingControl {
+    alignas(RING_CACHE_LINE) std::atomic<uint64_t> head;
+    alignas(RING_CACHE_LINE) std::atomic<uint64_t> processed;
+    alignas(RING_CACHE_LINE) std::atomic<uint64_t> tail;
+    alignas(RING_CACHE_LINE) std::atomic<uint32_t> exitFlag;
+#ifdef IPC_ENABLE_PHASE_TIMING
+    alignas(RING_CACHE_LINE) PhaseTimes childTimes;   // cumulative, written by the child only
+#endif
+};
+
+// descriptor of one ring slot, padded so neighbouring slots don't share a line
+struct alignas(RING_CACHE_LINE) RingSlot {
+    uint32_t bytes;     // valid payload bytes in the slot, always whole elements
+    uint8_t dtype;      // WireDtype of the elements; the shape stays with the parent
+    uint8_t op;         // MatrixOp to apply, elementwise
+    uint64_t requestId; // request the payload belongs to; a request spans consecutive slots
+};
+
+class IPCSharedMemoryRing : public IPCMethod {
+public:
+    IPCSharedMemoryRing(size_t slotCount = 16, size_t slotBytes = 128*128*sizeof(CPP_TENSOR_DTYPE));
+    ~IPCSharedMemoryRing() override;
+    std::string methodName() const override { return "SharedMemoryRing"; }
+
+    void initSubprocess() override;
+    torch::Tensor sendAndReceiveV2(const torch::Tensor& matrix) override;
+    std::future<torch::Tensor> submit(const torch::Tensor& matrix) override;
+    std::vector<pid_t> workerPids() const override { return childPid > 0 ? std::vector<pid_t>{childPid} : std::vector<pid_t>{}; }
+    size_t outstandingRequests() override { return completions.inFlight(); }
+    // slots carry elements without a shape
+    bool supportsOperation(MatrixOp op) const override { return MatrixOperation::operation(op).elementwise(); }
+    void exitSubprocess() override;
+    // a spawned worker maps the segment by name
+    bool supportsSpawn() const override { return true; }
+    void serveWorker(const ChannelArguments& args) override;
+
+private:
+    int shmFd = -1;                                // file descriptor for the shared memory object
+    void* shmAddr = nullptr;                       // start of the mapped segment
+    size_t shmSize = 0;                            // control block + slot table + payload
+    std::string shmName;                           // name of the shared memory object, unique per channel
+    pid_t childPid = -1;
+
+    size_t slotCount;                              // number of slots in the ring
+    size_t slotBytes;                              // payload capacity of a slot, a multiple of every element size
+
+    RingControl* control = nullptr;                // indices, inside the segment
+    RingSlot* slots = nullptr;                     // slot descriptors, inside the segment
+    char* payload = nullptr;                       // slot payloads, inside the segment
+
+    // while requests from submit() are outstanding, head is advanced by the submitting
+    // thread and tail by the completion thread, so each index still has a single writer
+    AsyncCompletions completions;
+
+    char* slotData(uint64_t index) const;
+    void mapSegment();
+    void processRing();                            // child loop
+    void completeOneRequest();                     // completion thread
+};
+
+#endif // IPCSHAREDMEMORYRING_H
@@ -2,36 +2,91 @@
 #define IPCSOCKET_H 
 
 #include "IPCMethod.h"
+#include "AsyncCompletions.h"
+#include "IoUring.h"
+#include "TensorWire.h"
+#include <cstdint>
+#include <deque>
 #include <string>
+#include <utility>
 #include <vector>
+#include <sys/uio.h>
+
+// header in front of every tensor on the socket. the child echoes requestId in front of
+// the result; a header with terminate set is the termination signal and has no payload
+struct TensorFrameHeader {
+    int32_t terminate;
+    int32_t reserved;
+    uint64_t requestId;
+    TensorWireHeader tensor;
+};
 
 class IPCSocket: public IPCMethod {
     public:
-        IPCSocket();
+        // zeroCopy sends large payloads with MSG_ZEROCOPY (TCP only; ignored where the
+        // kernel doesn't support it). port is the loopback TCP port of this channel; 0 lets
+        // the kernel pick a free one so any number of channels can coexist. ioUring moves
+        // the same frames through io_uring instead of sendmsg/read (not with zeroCopy).
+        // streaming has the child process and return each chunk as it arrives (plain
+        // sendmsg/read only, elementwise ops only)
+        IPCSocket(bool zeroCopy = false, int port = 0, IoUringMode ioUring = IO_URING_OFF, bool streaming = false);
         ~IPCSocket() override;
         void initSubprocess() override;               // setup communication channel and fork
         void exitSubprocess() override;               // close communication channel and exit
-        void sendAndReceive(int matrixSize) override; // placeholder for backward compatibility
         torch::Tensor sendAndReceiveV2(const torch::Tensor& matrix) override; // actual implementation for tensor transmission
-        std::string methodName() const override { return "Socket"; }
-    private:
+        std::future<torch::Tensor> submit(const torch::Tensor& matrix) override;
+        std::vector<pid_t> workerPids() const override { return childPid > 0 ? std::vector<pid_t>{childPid} : std::vector<pid_t>{}; }
+        size_t outstandingRequests() override { return completions.inFlight(); }
+        bool supportsOperation(MatrixOp op) const override {
+            return !streaming || MatrixOperation::operation(op).elementwise();
+        }
+        std::string methodName() const override;
+        // a spawned worker connects back to the listening port
+        bool supportsSpawn() const override { return true; }
+        void serveWorker(const ChannelArguments& args) override;
+    protected:
         int serverFd = -1;     // server socket file descriptor
         int clientFd = -1;     // client socket file descriptor
         pid_t childPid = -1;   // PID of the child process
-        int customPort = 8080; // port number for socket communication
+        int customPort = 0;    // port number for socket communication, 0 until bound to a free one
+        size_t maxMessageSize = 0; // >0 for message oriented sockets: cap on bytes per read/write call
+
+        // MSG_ZEROCOPY state: a sent buffer must stay untouched until the kernel reports
+        // its completion on the socket error queue, so tensors are pinned until then
+        bool zeroCopy = false;
+        uint32_t zeroCopySent = 0;      // zerocopy sendmsg calls issued
+        uint32_t zeroCopyCompleted = 0; // zerocopy sendmsg calls the kernel reported done
+        bool zeroCopyWasCopied = false; // kernel fell back to copying (e.g. loopback)
+        std::deque<std::pair<uint32_t, torch::Tensor>> zeroCopyPinned;
+
+        AsyncCompletions completions; // requests sent by submit() whose results are still due
+        bool streaming = false;        // child works chunk by chunk; requests always go through submit()
+        torch::Tensor streamChunk;     // child: the one chunk in flight through it
+        IoUringMode ioUringMode = IO_URING_OFF;
+        IoUring sendRing;      // writes of the thread that sends requests (child: results)
+        IoUring receiveRing;   // reads of the thread that reads results (child: requests)
+
+        void serveFromPort(int port); // child: connect to the parent on loopback, then serveClient
+        void serveClient();    // child loop: receive, apply the op, send back until termination
+        void streamApply(const TensorFrameHeader& header); // child: apply the op to one request chunk by chunk
+        void completeOneRequest(); // completion thread
+        void setupIoUring();       // after the fork, on both sides
 
         // utility methods for socket operations
         int createSocket();
         void connectToServer(int sock, const char* serverAddress, int port);
         void setupServer(int& server_fd, int port, struct sockaddr_in& address);
         void closeSockets();
-        void sendTensor(int socketFd, const torch::Tensor& tensor);
-        torch::Tensor receiveTensor(int socketFd, int matrixSize=-1);
+        // payload as encodeRequest returned it; the received tensor is decoded again
+        void sendTensor(int socketFd, const torch::Tensor& payload, const TensorWireHeader& tensorHeader, uint64_t requestId = 0);
+        torch::Tensor receiveTensor(int socketFd, uint64_t* requestId = nullptr);
+        torch::Tensor receivePayload(int socketFd, const TensorWireHeader& header);
 
-        std::vector<char> serializeTensor(const torch::Tensor &tensor);
-        torch::Tensor deserializeTensor(const std::vector<char> &buffer, const std::vector<int64_t> &size);
         ssize_t read_full(int fd, char *buf, size_t count);
         ssize_t write_full(int fd, const char *buf, size_t count);
+        ssize_t sendmsg_full(int fd, struct iovec *iov, int iovcnt, int flags, bool* zeroCopied = nullptr);
+        void enableZeroCopy(int fd);
+        void reapZeroCopyCompletions(int fd, bool wait);
 
 };
 
@@ -0,0 +1,69 @@
+#ifndef IPCSUBMISSIONQUEUE_H
+#define IPCSUBMISSIONQUEUE_H
+
+#include "IPCMethod.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// lets any number of threads share one inner transport. an IPCMethod expects a single caller:
+// its submit() and sendAndReceiveV2() write the channel (segment, control pipe, socket)
+// without locking. here callers only append to a queue; one dispatcher thread takes requests
+// off it in order and is the only thread that submits to the inner transport, so the channel
+// keeps a single writer. every request gets its own completion slot, which the completer
+// thread fills from the inner result.
+class IPCSubmissionQueue : public IPCMethod {
+public:
+    explicit IPCSubmissionQueue(std::unique_ptr<IPCMethod> inner);
+    ~IPCSubmissionQueue() override;
+    std::string methodName() const override { return inner->methodName(); }
+
+    void initSubprocess() override;               // also starts the dispatcher and completer
+    void exitSubprocess() override;               // waits for every queued request first
+    torch::Tensor sendAndReceiveV2(const torch::Tensor& matrix) override; // any thread
+    std::future<torch::Tensor> submit(const torch::Tensor& matrix) override; // any thread
+    size_t outstandingRequests() override;
+    std::vector<pid_t> workerPids() const override { return inner->workerPids(); }
+    torch::Tensor allocateMatrix(int rows, int cols, torch::ScalarType dtype = MATRIX_DTYPE) override {
+        return inner->allocateMatrix(rows, cols, dtype);
+    }
+    bool supportsOperation(MatrixOp op) const override { return inner->supportsOperation(op); }
+    bool supportsSpawn() const override { return inner->supportsSpawn(); }
+
+    // settings of the inner transport change between requests only, so these wait until
+    // every queued request has completed
+    void setOperation(MatrixOp op) override;
+    void setSparseThreshold(double density) override;
+    void setLaunchMode(LaunchMode mode) override;
+    void setMaxInFlight(size_t window) override;   // the queue and the inner transport
+
+    const PhaseStats& phaseStats() const override { return inner->phaseStats(); }
+    void resetPhaseStats() override { inner->resetPhaseStats(); }
+
+private:
+    struct Request {
+        torch::Tensor matrix;
+        std::promise<torch::Tensor> slot;         // what the caller waits on
+        std::future<torch::Tensor> result;        // from the inner transport, once dispatched
+    };
+
+    std::unique_ptr<IPCMethod> inner;
+
+    std::mutex mutex;
+    std::condition_variable changed;              // request queued, dispatched or completed, or stopping
+    std::deque<Request> queued;                   // submitted, not yet handed to the inner transport
+    std::deque<Request> dispatched;               // handed over, in submission order
+    size_t outstanding = 0;                       // submitted and not completed
+    bool stopping = false;
+    std::thread dispatchThread;
+    std::thread completeThread;
+
+    void waitIdle();                              // until nothing is outstanding
+    void stopThreads();
+    void dispatchLoop();
+    void completeLoop();
+};
+
+#endif // IPCSUBMISSIONQUEUE_H
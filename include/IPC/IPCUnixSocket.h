@@ -0,0 +1,22 @@
+#ifndef IPCUNIXSOCKET_H
+#define IPCUNIXSOCKET_H
+
+#include "IPCSocket.h"
+#include <sys/socket.h>
+
+// same framing and child loop as IPCSocket, but over a connected AF_UNIX socket pair so no
+// byte goes through the TCP/IP stack. socketType is SOCK_STREAM or SOCK_SEQPACKET.
+class IPCUnixSocket : public IPCSocket {
+    public:
+        IPCUnixSocket(int socketType = SOCK_STREAM);
+        void initSubprocess() override;
+        // a spawned worker inherits its end of the socket pair
+        void serveWorker(const ChannelArguments& args) override;
+        std::string methodName() const override {
+            return socketType == SOCK_SEQPACKET ? "UnixSeqpacket" : "UnixStream";
+        }
+    private:
+        int socketType;
+};
+
+#endif // IPCUNIXSOCKET_H
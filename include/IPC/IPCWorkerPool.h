@@ -0,0 +1,47 @@
+#ifndef IPCWORKERPOOL_H
+#define IPCWORKERPOOL_H
+
+#include "IPCMethod.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+// N instances of one transport, each with its own child and its own channel (segment,
+// semaphores, pipes or socket). requests go to the worker with the fewest outstanding
+// requests, so a slow child doesn't hold up the others.
+class IPCWorkerPool : public IPCMethod {
+public:
+    using WorkerFactory = std::function<std::unique_ptr<IPCMethod>()>;
+
+    // workerCount 0 = one worker per online core
+    IPCWorkerPool(WorkerFactory factory, size_t workerCount = 0);
+    std::string methodName() const override { return workers.front()->methodName(); }
+
+    void initSubprocess() override;               // starts every worker
+    void exitSubprocess() override;
+    torch::Tensor sendAndReceiveV2(const torch::Tensor& matrix) override;
+    std::future<torch::Tensor> submit(const torch::Tensor& matrix) override;
+    size_t outstandingRequests() override;
+    std::vector<pid_t> workerPids() const override;
+    void setSparseThreshold(double density) override;
+    void setOperation(MatrixOp op) override;
+    bool supportsOperation(MatrixOp op) const override { return workers.front()->supportsOperation(op); }
+    void setLaunchMode(LaunchMode mode) override;
+    bool supportsSpawn() const override { return workers.front()->supportsSpawn(); }
+
+    // phases of all workers together
+    const PhaseStats& phaseStats() const override;
+    void resetPhaseStats() override;
+
+    size_t workerCount() const { return workers.size(); }
+    static size_t defaultWorkerCount();           // online cores
+
+private:
+    std::vector<std::unique_ptr<IPCMethod>> workers;
+    size_t nextWorker = 0;                        // round robin start, breaks ties between idle workers
+    mutable PhaseStats mergedPhases;
+
+    IPCMethod& leastLoadedWorker();
+};
+
+#endif // IPCWORKERPOOL_H
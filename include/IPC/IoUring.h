@@ -0,0 +1,86 @@
+#ifndef IOURING_H
+#define IOURING_H
+
+#include <cstddef>
+#include <vector>
+#include <sys/types.h>
+
+// how a transport moves its bytes
+enum IoUringMode {
+    IO_URING_OFF = 0, // one read/write syscall per chunk
+    IO_URING_ON,      // batched submissions through an io_uring, one io_uring_enter per batch
+    IO_URING_SQPOLL   // a kernel thread polls the submission queue; the caller polls completions
+};
+
+// minimal io_uring on the raw syscalls (no liburing): queue reads and writes, submit them in
+// one go and wait until every byte has moved. one ring belongs to one thread, and to the
+// process that created it, so rings are set up after fork.
+class IoUring {
+public:
+    IoUring() = default;
+    ~IoUring();
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // false when the kernel has no io_uring (or forbids it); the ring then stays unavailable
+    // and callers keep using read/write. SQPOLL falls back to a plain ring when not permitted.
+    bool init(IoUringMode mode, const std::vector<int>& fds);
+    bool available() const { return ringFd != -1; }
+    bool sqpoll() const { return sqpollEnabled; }
+    void close();
+
+    // registered buffer of at least 'bytes', regrown (and re-registered) on demand. reads and
+    // writes that fall inside it use the fixed buffer opcodes. valid until the next call.
+    char* stagingBuffer(size_t bytes);
+
+    // queue one transfer. in a batch they run in queue order (linked), short transfers and
+    // the ones cancelled behind them are resubmitted until done
+    void queueRead(int fd, void* data, size_t length);
+    void queueWrite(int fd, const void* data, size_t length);
+
+    // submit everything queued and wait for it. returns the bytes moved, which is less than
+    // queued when a read hit end of file, or -1 with errno set on error
+    ssize_t transferAll();
+
+    ssize_t readFull(int fd, void* data, size_t length);
+    ssize_t writeFull(int fd, const void* data, size_t length);
+
+private:
+    struct Transfer {
+        int fd;
+        bool write;
+        char* data;
+        size_t length;
+        size_t done;
+    };
+
+    int ringFd = -1;
+    bool sqpollEnabled = false;
+    std::vector<int> fixedFds;          // registered files, by fixed index
+
+    // rings shared with the kernel
+    void* sqRing = nullptr;
+    size_t sqRingSize = 0;
+    void* cqRing = nullptr;
+    size_t cqRingSize = 0;
+    void* sqes = nullptr;
+    size_t sqesSize = 0;
+    unsigned *sqHead = nullptr, *sqTail = nullptr, *sqMask = nullptr, *sqArray = nullptr, *sqFlags = nullptr;
+    unsigned sqEntries = 0;
+    unsigned *cqHead = nullptr, *cqTail = nullptr, *cqMask = nullptr;
+    void* cqes = nullptr;
+
+    char* staging = nullptr;            // registered buffer 0
+    size_t stagingSize = 0;
+    bool stagingRegistered = false;
+    bool bufferRegistration = true;     // cleared once the kernel refused to register a buffer
+
+    std::vector<Transfer> queued;
+
+    bool setup(unsigned entries, bool withSqpoll);
+    void queue(int fd, bool write, char* data, size_t length);
+    bool submitChain(std::vector<Transfer>& batch, const std::vector<size_t>& pending);
+    bool reapCompletion(size_t& index, int& result);
+};
+
+#endif // IOURING_H
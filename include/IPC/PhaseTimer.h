@@ -0,0 +1,106 @@
+#ifndef PHASETIMER_H
+#define PHASETIMER_H
+
+#include <cstdint>
+#include <cstring>
+#include <time.h>
+
+// phases of one request. parent and child phases overlap in wall time: the parent's Read
+// includes waiting for the child to wake, compute and write back.
+enum Phase {
+    PHASE_SERIALIZE = 0, // parent: preparing the payload (contiguous copy, headers)
+    PHASE_WRITE,         // parent: moving the payload into the channel
+    PHASE_CHILD_WAKE,    // parent write start -> child picks the request up
+    PHASE_CHILD_READ,    // child: taking the payload out of the channel
+    PHASE_COMPUTE,       // child: the operation itself
+    PHASE_CHILD_WRITE,   // child: moving the result into the channel
+    PHASE_READ,          // parent: waiting for and taking the result out of the channel
+    PHASE_DESERIALIZE,   // parent: turning the received bytes into a tensor
+    PHASE_COUNT
+};
+
+const char* phaseName(int phase);
+
+// CLOCK_MONOTONIC is system wide, so parent and child timestamps can be compared
+inline uint64_t phaseClockNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+// per request phase durations. trivially copyable so the child can ship it back with
+// the result over any transport.
+struct PhaseTimes {
+    uint64_t wakeNs;             // child only: timestamp when it picked the request up
+    uint64_t ns[PHASE_COUNT];    // accumulated duration per phase
+
+    void clear() { std::memset(this, 0, sizeof(*this)); }
+};
+
+// log-linear histogram: 16 linear sub-buckets per power of two (~6% relative error),
+// fixed size so recording is a couple of instructions and never allocates
+class LogLinearHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int BUCKETS = SUB_BUCKETS + (64 - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+    LogLinearHistogram() { clear(); }
+    void clear();
+    void record(uint64_t value);
+    void merge(const LogLinearHistogram& other);
+
+    uint64_t count() const { return total; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0; }
+    uint64_t percentile(double p) const; // lower bound of the bucket holding the p-th percentile
+
+private:
+    uint64_t counts[BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+
+    static int bucketIndex(uint64_t value);
+    static uint64_t bucketLowerBound(int index);
+};
+
+#ifdef IPC_ENABLE_PHASE_TIMING
+// one histogram per phase, kept by every IPCMethod on the parent side
+class PhaseStats {
+public:
+    void clear();
+    void recordParent(const PhaseTimes& times);
+    // child durations, plus the wake-up latency measured from the parent's request start
+    void recordChild(const PhaseTimes& times, uint64_t requestStartNs);
+    void merge(const PhaseStats& other);
+    const LogLinearHistogram& histogram(int phase) const { return histograms[phase]; }
+
+private:
+    LogLinearHistogram histograms[PHASE_COUNT];
+};
+#else
+// without phase timing an IPCMethod carries this empty stand-in instead of the histograms
+class PhaseStats {
+public:
+    void clear() {}
+    void recordParent(const PhaseTimes&) {}
+    void recordChild(const PhaseTimes&, uint64_t) {}
+    void merge(const PhaseStats&) {}
+};
+#endif
+
+// instrumentation hooks; compile to nothing unless IPC_ENABLE_PHASE_TIMING is defined
+#ifdef IPC_ENABLE_PHASE_TIMING
+#define IPC_PHASE_TIMES(times) PhaseTimes times; times.clear()
+#define IPC_PHASE_START(var) uint64_t var = phaseClockNs()
+#define IPC_PHASE_ADD(times, phase, var) ((times).ns[phase] += phaseClockNs() - (var))
+#define IPC_PHASE_MARK_WAKE(times) ((times).wakeNs = phaseClockNs())
+#define IPC_PHASE_COMMIT(stats, times) (stats).recordParent(times)
+#else
+#define IPC_PHASE_TIMES(times) do {} while (0)
+#define IPC_PHASE_START(var) do {} while (0)
+#define IPC_PHASE_ADD(times, phase, var) do {} while (0)
+#define IPC_PHASE_MARK_WAKE(times) do {} while (0)
+#define IPC_PHASE_COMMIT(stats, times) do {} while (0)
+#endif
+
+#endif // PHASETIMER_H
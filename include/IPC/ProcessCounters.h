@@ -0,0 +1,65 @@
+#ifndef PROCESSCOUNTERS_H
+#define PROCESSCOUNTERS_H
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// fault and scheduling counters of a process, cumulative since it started
+struct ProcessCounters {
+    double minorFaults = 0;
+    double majorFaults = 0;
+    double voluntarySwitches = 0;   // gave up the cpu: waiting on a pipe, socket, futex ...
+    double involuntarySwitches = 0; // preempted
+
+    double switches() const { return voluntarySwitches + involuntarySwitches; }
+    ProcessCounters& operator+=(const ProcessCounters& other);
+    ProcessCounters operator-(const ProcessCounters& other) const;
+};
+
+// this process, all of its threads (getrusage)
+ProcessCounters selfCounters();
+
+// the given processes together: faults of the whole process from /proc/<pid>/stat, switches
+// of its main thread (the one serving requests) from /proc/<pid>/status. a process that is
+// gone counts as zero
+ProcessCounters processCounters(const std::vector<pid_t>& pids);
+
+// a kB field of /proc/<pid>/status (VmRSS, VmHWM ...); pid 0 is this process, 0 if unreadable
+double statusKb(pid_t pid, const std::string& field);
+
+// software events count for any process we may ptrace under perf_event_paranoid <= 2; the
+// hardware ones need a PMU, which many VMs and containers don't expose
+enum PerfEvent {
+    PERF_TASK_CLOCK = 0, // us on a cpu
+    PERF_CONTEXT_SWITCHES,
+    PERF_CPU_MIGRATIONS,
+    PERF_MINOR_FAULTS,
+    PERF_MAJOR_FAULTS,
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_EVENT_COUNT
+};
+
+const char* perfEventName(int event); // task_clock_us, context_switches ...
+
+// perf_event_open counters of the main threads of a set of processes (0 = the calling
+// thread), summed. an event is available only if it could be opened for all of them
+class PerfCounters {
+public:
+    explicit PerfCounters(const std::vector<pid_t>& pids);
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available(int event) const { return !fds[event].empty(); }
+    bool anyAvailable() const;
+    // totals so far, scaled up for the time an event was multiplexed out; -1 where unavailable
+    std::vector<double> read() const;
+
+private:
+    std::vector<int> fds[PERF_EVENT_COUNT]; // one per process
+};
+
+#endif // PROCESSCOUNTERS_H
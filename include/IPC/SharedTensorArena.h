@@ -0,0 +1,54 @@
+#ifndef SHAREDTENSORARENA_H
+#define SHAREDTENSORARENA_H
+
+#include <torch/torch.h>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// first-fit allocator over a region of a shared memory segment. blocks are handed out as
+// torch::Tensors whose deleter returns the block, so a tensor allocated here can be read
+// and written by the child in place without any copy through an intermediate buffer.
+// the allocator bookkeeping lives in the owning (parent) process only.
+class SharedTensorArena {
+public:
+    SharedTensorArena(void* base, size_t capacity, size_t alignment = 64);
+
+    // allocate an uninitialized tensor inside the arena; returns an undefined tensor when
+    // the arena has no free block large enough
+    torch::Tensor allocateTensor(at::IntArrayRef sizes, torch::ScalarType dtype);
+
+    // hand the mapping that backs the arena over to it; it is unmapped once the arena and
+    // every tensor allocated from it are gone
+    void adoptMapping(void* addr, size_t length);
+
+    bool contains(const void* ptr, size_t bytes) const;
+    size_t offsetOf(const void* ptr) const;
+    void* base() const { return state->base; }
+    size_t capacity() const { return state->capacity; }
+    size_t bytesInUse() const;
+
+private:
+    struct State {
+        char* base;
+        size_t capacity;
+        size_t alignment;
+        std::mutex mutex;
+        std::map<size_t, size_t> freeBlocks; // offset -> size, kept coalesced
+        std::map<size_t, size_t> usedBlocks; // offset -> size
+        size_t bytesInUse = 0;
+        void* mappingAddr = nullptr;
+        size_t mappingLength = 0;
+
+        ~State();
+
+        bool allocate(size_t bytes, size_t& offset);
+        void release(size_t offset);
+    };
+    // shared with the deleters of outstanding tensors so a tensor that outlives the arena
+    // object can still return its block safely
+    std::shared_ptr<State> state;
+};
+
+#endif // SHAREDTENSORARENA_H
@@ -0,0 +1,127 @@
+#ifndef TENSORWIRE_H
+#define TENSORWIRE_H
+
+#include <torch/torch.h>
+#include <cstddef>
+#include <cstdint>
+
+// element types a tensor can travel in, each at its native width
+enum WireDtype : uint8_t {
+    WIRE_FLOAT32 = 0,
+    WIRE_FLOAT64,
+    WIRE_FLOAT16,
+    WIRE_BFLOAT16,
+    WIRE_INT8,
+    WIRE_UINT8,
+    WIRE_INT16,
+    WIRE_INT32,
+    WIRE_INT64,
+    WIRE_DTYPE_COUNT
+};
+
+#define TENSOR_WIRE_MAX_RANK 6
+
+// payload is in row-major order and the strides are not used. without it the payload is
+// the tensor's memory as is (a transposed matrix, say) and the strides describe it
+#define TENSOR_WIRE_CONTIGUOUS 0x1
+
+// payload is a sparse encoding of a 2-D tensor with nnz stored elements: the values
+// first, then int32 indices. only the values need touching for an op that keeps zeros zero
+#define TENSOR_WIRE_SPARSE_CSR 0x2 // values, column indices, row offsets (rows + 1)
+#define TENSOR_WIRE_SPARSE_COO 0x4 // values, row indices, column indices
+
+// streaming children square and send back a payload in chunks of this many bytes. a
+// multiple of 8, so no element straddles two chunks
+#define TENSOR_WIRE_STREAM_CHUNK (64 * 1024)
+
+// fixed size description of a tensor, sent in front of its payload. a dense payload is
+// the numel() * element size bytes the tensor covers, without gaps
+struct TensorWireHeader {
+    uint8_t dtype;                              // WireDtype
+    uint8_t rank;
+    uint8_t flags;
+    uint8_t op;                                 // MatrixOp of a request, echoed on its result
+    uint8_t reserved[4];
+    int64_t nnz;                                // stored elements of a sparse payload
+    int64_t shape[TENSOR_WIRE_MAX_RANK];
+    int64_t strides[TENSOR_WIRE_MAX_RANK];      // in elements
+};
+
+// compile-time mapping from element types to their wire code and torch dtype
+template <typename T> struct WireTraits;
+#define TENSOR_WIRE_TYPE(type, code, scalar) \
+    template <> struct WireTraits<type> { \
+        static constexpr WireDtype dtype = code; \
+        static constexpr torch::ScalarType scalarType = scalar; \
+    };
+TENSOR_WIRE_TYPE(float, WIRE_FLOAT32, torch::kFloat32)
+TENSOR_WIRE_TYPE(double, WIRE_FLOAT64, torch::kFloat64)
+TENSOR_WIRE_TYPE(c10::Half, WIRE_FLOAT16, torch::kFloat16)
+TENSOR_WIRE_TYPE(c10::BFloat16, WIRE_BFLOAT16, torch::kBFloat16)
+TENSOR_WIRE_TYPE(int8_t, WIRE_INT8, torch::kInt8)
+TENSOR_WIRE_TYPE(uint8_t, WIRE_UINT8, torch::kUInt8)
+TENSOR_WIRE_TYPE(int16_t, WIRE_INT16, torch::kInt16)
+TENSOR_WIRE_TYPE(int32_t, WIRE_INT32, torch::kInt32)
+TENSOR_WIRE_TYPE(int64_t, WIRE_INT64, torch::kInt64)
+#undef TENSOR_WIRE_TYPE
+
+template <typename T> struct WireTag { using type = T; };
+
+// calls fn(WireTag<T>()) for the element type T of a (validated) wire dtype, so the
+// transfer code behind it is compiled once per type with sizeof(T) known
+template <typename Fn>
+auto visitWireDtype(uint8_t dtype, Fn&& fn) -> decltype(fn(WireTag<float>())) {
+    switch (dtype) {
+    case WIRE_FLOAT64:  return fn(WireTag<double>());
+    case WIRE_FLOAT16:  return fn(WireTag<c10::Half>());
+    case WIRE_BFLOAT16: return fn(WireTag<c10::BFloat16>());
+    case WIRE_INT8:     return fn(WireTag<int8_t>());
+    case WIRE_UINT8:    return fn(WireTag<uint8_t>());
+    case WIRE_INT16:    return fn(WireTag<int16_t>());
+    case WIRE_INT32:    return fn(WireTag<int32_t>());
+    case WIRE_INT64:    return fn(WireTag<int64_t>());
+    default:            return fn(WireTag<float>());
+    }
+}
+
+WireDtype wireDtypeOf(torch::ScalarType scalarType);   // exits on types with no wire code
+torch::ScalarType wireScalarType(uint8_t dtype);
+size_t wireElementSize(uint8_t dtype);
+const char* wireDtypeName(uint8_t dtype);
+bool parseWireDtype(const std::string& name, torch::ScalarType& scalarType);
+
+// the tensor itself when its memory is one gap-free block (contiguous, transposed,
+// permuted), a contiguous copy otherwise; what a transport sends straight from memory
+torch::Tensor wireLayout(const torch::Tensor& tensor);
+
+// header of a tensor already in wire layout
+TensorWireHeader describeTensor(const torch::Tensor& tensor);
+bool validWireHeader(const TensorWireHeader& header);
+int64_t wireElements(const TensorWireHeader& header);
+size_t wirePayloadBytes(const TensorWireHeader& header);
+
+// receiving side: a tensor the payload can be read straight into (from the BufferPool), or
+// one over a payload that is already in memory (borrowed, not copied). sparse payloads come
+// as uint8 buffers
+torch::Tensor emptyFromWire(const TensorWireHeader& header);
+torch::Tensor tensorFromWire(void* payload, const TensorWireHeader& header);
+
+inline bool wireSparse(const TensorWireHeader& header) {
+    return header.flags & (TENSOR_WIRE_SPARSE_CSR | TENSOR_WIRE_SPARSE_COO);
+}
+
+// share of nonzero elements in an evenly spread sample of at most 'samples' elements
+double estimateDensity(const torch::Tensor& tensor, int64_t samples = 1024);
+
+// the payload to send for a tensor, and its header: a sparse encoding when the estimated
+// density is below sparseThreshold and the encoding is smaller than the dense payload,
+// the wire layout of the tensor otherwise. only 2-D tensors are encoded; 0 never encodes
+torch::Tensor encodeForWire(const torch::Tensor& tensor, double sparseThreshold, TensorWireHeader& header);
+
+// the stored values of a payload, in place: all of a dense one, the first nnz of a sparse one
+torch::Tensor wireValues(const torch::Tensor& payload, const TensorWireHeader& header);
+
+// the dense tensor a received payload stands for (the payload itself when it is dense)
+torch::Tensor decodeFromWire(const torch::Tensor& payload, const TensorWireHeader& header);
+
+#endif // TENSORWIRE_H
@@ -0,0 +1,43 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// where one logical cpu sits, as reported by sysfs
+struct CpuInfo {
+    int cpu;
+    int core;     // core_id, shared by SMT siblings
+    int package;  // physical_package_id (socket)
+    int llc;      // lowest cpu sharing the last level cache, -1 if unknown
+    int node;     // NUMA node, -1 if unknown
+};
+
+// where the parent and the children of a run are pinned
+struct Placement {
+    std::string name;           // preset name, "custom", or "unpinned"
+    int parentCpu = -1;         // -1 leaves the parent unpinned
+    std::vector<int> childCpus; // children are pinned round robin; empty leaves them unpinned
+    int numaNode = -1;          // -1 leaves the memory policy alone
+
+    std::string describe() const; // e.g. "smt-sibling parent=0 children=8 node=0"
+};
+
+// online cpus with their core, socket, cache and node
+std::vector<CpuInfo> readCpuTopology();
+
+// same-core, smt-sibling, same-llc and cross-socket placements relative to the first online
+// cpu; presets this machine can't express (no SMT, single socket, ...) are left out
+std::vector<Placement> placementPresets();
+std::vector<std::string> placementPresetNames();
+
+// pin a process (0 = the calling thread; threads created later inherit it) to one cpu
+bool pinToCpu(pid_t pid, int cpu);
+
+// allocate all further memory of this process, and of children forked later, on 'node'.
+// shared segments are placed by whoever faults them in, so this covers them as long as it
+// is set before the transport is created. node -1 restores the default policy.
+bool bindMemoryToNode(int node);
+
+#endif // TOPOLOGY_H
@@ -0,0 +1,59 @@
+#ifndef WAITSTRATEGY_H
+#define WAITSTRATEGY_H
+
+#include <atomic>
+#include <cstdint>
+
+// how one side of a shared memory handshake waits for the other
+enum WaitStrategy {
+    WAIT_SEMAPHORE = 0, // named POSIX semaphores; sleeps in the kernel when there is nothing to do
+    WAIT_BUSY_POLL,     // spin on a shared counter; lowest latency, burns a whole core while waiting
+    WAIT_SPIN_FUTEX,    // spin for an adaptive number of polls, then sleep in futex on the counter
+    WAIT_EVENTFD,       // block in read() on an eventfd
+    WAIT_EVENTFD_EPOLL  // sleep in epoll_wait on the eventfd, the way an event loop would
+};
+
+const char* waitStrategyName(WaitStrategy strategy);
+
+// tell the cpu we are in a spin-wait loop
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// counting signal for one direction of a handshake. it lives in memory shared by parent and
+// child, so the futex calls use the shared (non private) form.
+struct alignas(64) SharedSignal {
+    std::atomic<uint32_t> count;     // posts not consumed yet; doubles as the futex word
+    std::atomic<uint32_t> sleepers;  // waiters in (or on their way into) futex wait
+
+    void init();
+    void post();
+    void busyWait();
+    // spinBudget is the waiter's own (per process) number of polls before it sleeps; it grows
+    // while the other side keeps answering within it and shrinks when the waiter had to sleep
+    void spinThenFutexWait(int& spinBudget);
+
+private:
+    bool tryConsume();
+};
+
+// one direction of a handshake over an eventfd. it is created before fork so both sides
+// inherit it, and unlike a named semaphore it can sit in an epoll set next to sockets and
+// timers. EFD_SEMAPHORE makes every read consume exactly one post.
+struct EventSignal {
+    int fd = -1;
+
+    void create(bool nonBlocking);   // nonBlocking for waiting through epoll
+    void post();
+    void wait();                     // blocking read
+    void waitWithEpoll(int epollFd); // epoll_wait until readable, then consume one post
+    void close();
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "signal counters must be lock-free to live in shared memory");
+
+#endif // WAITSTRATEGY_H
@@ -0,0 +1,36 @@
+#ifndef WORKERLAUNCHER_H
+#define WORKERLAUNCHER_H
+
+#include <map>
+#include <string>
+#include <sys/types.h>
+
+// how a transport starts its child. fork copies the parent as it is: libtorch, its thread
+// pools and every tensor allocated so far, so fork time and the child's footprint grow with
+// the parent. spawn starts the lean IPCWorker binary with posix_spawn instead, which attaches
+// to the channel by name or by an inherited fd
+enum LaunchMode {
+    LAUNCH_FORK = 0,
+    LAUNCH_SPAWN
+};
+
+const char* launchModeName(LaunchMode mode);
+bool parseLaunchMode(const std::string& name, LaunchMode& mode);
+
+// key=value arguments that tell IPCWorker which channel to attach to
+using ChannelArguments = std::map<std::string, std::string>;
+std::string channelArgument(const ChannelArguments& args, const std::string& key); // exits when missing
+long channelNumber(const ChannelArguments& args, const std::string& key);
+
+// $IPC_WORKER_PATH, or IPCWorker next to the running executable
+std::string workerBinaryPath();
+
+// posix_spawn IPCWorker serving the transport registered as 'transport'. it inherits every fd
+// not marked close-on-exec, so the caller marks its own ends of the channel FD_CLOEXEC first.
+// the kernel cap of the elementwise kernels is passed along
+pid_t spawnWorker(const std::string& transport, ChannelArguments args);
+
+// mark an fd close-on-exec, so a spawned worker doesn't inherit it
+void closeOnExec(int fd);
+
+#endif // WORKERLAUNCHER_H
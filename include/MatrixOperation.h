@@ -2,14 +2,61 @@
 #define MATRIXOPERATION_H
 
 #include <torch/torch.h>
+#include <string>
+#include <vector>
+#include "TensorWire.h"
+
+// operations a child can apply to a request. the parent picks one per request and it travels
+// in the op byte of the request's wire header. roughly in order of arithmetic intensity, from
+// one flop per element moved to O(n) of them
+enum MatrixOp : uint8_t {
+    OP_SQUARE = 0,  // x * x
+    OP_CHAIN,       // x + x^2 + ... + x^8 in one fused pass (Horner)
+    OP_ROW_SUM,     // sum of every row, one column back
+    OP_MATMUL,      // x * x^T
+    OP_GEMM_BIAS,   // x * x^T + bias, bias[j] = j % 8
+    OP_COUNT
+};
+
+// registry entry of an operation
+struct MatrixOpInfo {
+    const char* name;
+    // elementwise ops only: out[i] from in[i] for count elements of a wire dtype, zero staying
+    // zero. the child then works in place, on one batch or chunk at a time and on the values
+    // of a sparse payload; other ops need the whole dense matrix
+    void (*elements)(const void* in, void* out, int64_t count, uint8_t dtype);
+    torch::Tensor (*apply)(const torch::Tensor& matrix);   // any layout, into a new tensor
+    bool (*verify)(const torch::Tensor& original, const torch::Tensor& result);
+    std::vector<int64_t> (*resultShape)(at::IntArrayRef sizes);
+    double (*flops)(at::IntArrayRef sizes);
+
+    bool elementwise() const { return elements != nullptr; }
+};
 
 class MatrixOperation {
 public:
     static torch::Tensor generateRandomMatrix(int size);
+    static void fillRandomMatrix(torch::Tensor& matrix); // same distribution, in place; small integers for integer types
+    static void sparsifyMatrix(torch::Tensor& matrix, double density); // keeps about this share of the elements
     static torch::Tensor squareMatrix(const torch::Tensor& matrix);
-    static bool checkIfSquaredMatrix(const torch::Tensor& original, const torch::Tensor& squared);
+    static bool checkIfSquaredMatrix(const torch::Tensor& original, const torch::Tensor& result);
+
+    // the registry; exits on an op that is not in it (a corrupt header, say)
+    static const MatrixOpInfo& operation(uint8_t op);
+    static bool parseOperation(const std::string& name, MatrixOp& op);
+    // flops per byte moved: request and result payload, dense
+    static double arithmeticIntensity(MatrixOp op, at::IntArrayRef sizes, size_t elementSize);
+
+    // apply the op in header.op to a received payload and return the payload to send back,
+    // with header describing it. elementwise ops work in place and keep the header: on the
+    // stored values only of a sparse payload (the indices stay), on all elements of a dense
+    // one in whatever layout it came. other ops decode the payload and answer dense
+    static torch::Tensor applyPayload(const torch::Tensor& payload, TensorWireHeader& header);
+    // apply an elementwise op, in place, to the part of payload bytes [offset, offset + bytes)
+    // that holds values (all of a dense payload); offset must be a multiple of the element size
+    static void applyPayloadChunk(void* chunk, size_t offset, size_t bytes, const TensorWireHeader& header);
 
     static void printMatrix(const torch::Tensor& matrix);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,1264 @@
+#include "Benchmark.h"
+#include "IPCBatcher.h"
+#include "IPCFactory.h"
+#include "IPCSubmissionQueue.h"
+#include "IPCWorkerPool.h"
+#include "MatrixOperation.h"
+#include "TensorWire.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <getopt.h>
+#include <sched.h>
+#include <time.h>
+
+// upper end of a --threads sweep
+static const int MAX_CALLER_THREADS = 32;
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --transports A,B,...   transports to run (default: all)\n"
+              << "  --sizes MIN:MAX:FACTOR geometric sweep of matrix sizes (default: 16:1024:2)\n"
+              << "  --sizes N,M,...        explicit list of matrix sizes\n"
+              << "  --dtype NAME           element type: float32 (default), float64, float16, bfloat16,\n"
+              << "                         int8, uint8, int16, int32, int64\n"
+              << "  --ops A,B,...|all      what the children compute: square (default), chain, rowsum, matmul,\n"
+              << "                         gemm_bias; a transport skips the ops it can't run\n"
+              << "  --density D,E,...      share of nonzero elements to sweep (default: 1)\n"
+              << "  --sparse-threshold D|compare\n"
+              << "                         send matrices below density D CSR/COO encoded (default: 0, never),\n"
+              << "                         or run every cell dense and sparse and report the crossover\n"
+              << "  --kernel NAME          widest instruction set of the children's square kernel: scalar,\n"
+              << "                         sse2, avx2, avx512 or auto (default: the best this cpu has)\n"
+              << "  --launch fork|spawn    start children by fork (default) or by spawning the lean IPCWorker\n"
+              << "                         binary; transports that can't hand over their channel keep forking\n"
+              << "  --perf                 also count task-clock, context switches, migrations and faults of\n"
+              << "                         parent and children with perf_event_open, plus cycles, instructions\n"
+              << "                         and cache misses where the kernel exposes hardware counters\n"
+              << "  --warmup N             untimed requests per cell (default: 5)\n"
+              << "  --iterations N         timed requests per cell (default: 100)\n"
+              << "  --window N             requests kept in flight through submit() (default: 1, synchronous)\n"
+              << "  --workers N|cores      sweep worker pools of 1, 2, 4 .. N children per transport\n"
+              << "  --batch N              coalesce up to N matrices into one transfer (implies --window >= N)\n"
+              << "  --batch-delay US       send a partial batch after US microseconds, 0 = never (default: 200)\n"
+              << "  --threads N            sweep 1, 2, 4 .. N caller threads sharing each transport through a\n"
+              << "                         submission queue (at most " << MAX_CALLER_THREADS << ")\n"
+              << "  --placement NAME|sweep pin parent and children by preset: same-core, smt-sibling, same-llc,\n"
+              << "                         cross-socket, or all presets this machine has\n"
+              << "  --parent-cpu N         pin the parent to cpu N\n"
+              << "  --child-cpus A,B,...   pin the children to these cpus, round robin\n"
+              << "  --numa-node N          allocate the parent, children and shared segments on node N\n"
+              << "  --seed N               seed for the matrix contents (default: 42)\n"
+              << "  --csv PATH             write results as CSV\n"
+              << "  --json PATH            write results as JSON\n"
+              << "  --list                 list the available transports and exit\n"
+              << "  --help                 show this message\n";
+}
+
+static std::vector<std::string> splitList(const std::string& text, char separator) {
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, separator)) {
+        if (!part.empty()) {
+            parts.push_back(part);
+        }
+    }
+    return parts;
+}
+
+static int parsePositive(const char* option, const std::string& text) {
+    try {
+        size_t used = 0;
+        int value = std::stoi(text, &used);
+        if (used == text.size() && value >= 0) {
+            return value;
+        }
+    } catch (const std::exception&) {
+    }
+    std::cerr << "Invalid value for --" << option << ": " << text << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+static double parseFraction(const char* option, const std::string& text) {
+    try {
+        size_t used = 0;
+        double value = std::stod(text, &used);
+        if (used == text.size() && value >= 0 && value <= 1) {
+            return value;
+        }
+    } catch (const std::exception&) {
+    }
+    std::cerr << "Invalid value for --" << option << " (expected 0 to 1): " << text << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+// --placement picks presets; otherwise --parent-cpu / --child-cpus form one custom placement.
+// --numa-node applies to whichever placements run.
+static std::vector<Placement> resolvePlacements(const std::string& placementName, Placement custom) {
+    std::vector<Placement> placements;
+    if (placementName.empty()) {
+        if (custom.parentCpu < 0 && custom.childCpus.empty()) {
+            custom.name = custom.numaNode >= 0 ? "custom" : "unpinned";
+        }
+        placements.push_back(custom);
+        return placements;
+    }
+
+    auto names = placementPresetNames();
+    if (placementName != "sweep" && std::find(names.begin(), names.end(), placementName) == names.end()) {
+        std::cerr << "Unknown placement: " << placementName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    for (auto& preset : placementPresets()) {
+        if (placementName == "sweep" || preset.name == placementName) {
+            preset.numaNode = custom.numaNode;
+            placements.push_back(preset);
+        }
+    }
+    if (placements.empty()) {
+        std::cerr << "Placement " << placementName << " is not available on this machine" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return placements;
+}
+
+BenchmarkConfig Benchmark::parseArguments(int argc, char** argv) {
+    BenchmarkConfig config;
+    config.sizes = geometricSizes(16, 1024, 2.0);
+    std::string placementName;
+    Placement custom;
+    custom.name = "custom";
+
+    static struct option longOptions[] = {
+        {"transports", required_argument, nullptr, 't'},
+        {"sizes",      required_argument, nullptr, 's'},
+        {"dtype",      required_argument, nullptr, 'y'},
+        {"ops",        required_argument, nullptr, 'o'},
+        {"density",    required_argument, nullptr, 'e'},
+        {"sparse-threshold", required_argument, nullptr, 'z'},
+        {"kernel",     required_argument, nullptr, 'g'},
+        {"launch",     required_argument, nullptr, 'f'},
+        {"perf",       no_argument,       nullptr, 'v'},
+        {"warmup",     required_argument, nullptr, 'w'},
+        {"iterations", required_argument, nullptr, 'i'},
+        {"window",     required_argument, nullptr, 'n'},
+        {"workers",    required_argument, nullptr, 'p'},
+        {"batch",      required_argument, nullptr, 'b'},
+        {"batch-delay", required_argument, nullptr, 'd'},
+        {"threads",    required_argument, nullptr, 'x'},
+        {"placement",  required_argument, nullptr, 'a'},
+        {"parent-cpu", required_argument, nullptr, 'u'},
+        {"child-cpus", required_argument, nullptr, 'k'},
+        {"numa-node",  required_argument, nullptr, 'm'},
+        {"seed",       required_argument, nullptr, 'r'},
+        {"csv",        required_argument, nullptr, 'c'},
+        {"json",       required_argument, nullptr, 'j'},
+        {"list",       no_argument,       nullptr, 'l'},
+        {"help",       no_argument,       nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", longOptions, nullptr)) != -1) {
+        switch (opt) {
+        case 't':
+            config.transports = splitList(optarg, ',');
+            break;
+        case 's': {
+            std::string text = optarg;
+            if (text.find(':') != std::string::npos) {
+                auto parts = splitList(text, ':');
+                if (parts.size() != 3) {
+                    std::cerr << "--sizes expects MIN:MAX:FACTOR" << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+                double factor = std::stod(parts[2]);
+                if (factor <= 1.0) {
+                    std::cerr << "--sizes factor must be greater than 1" << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+                config.sizes = geometricSizes(parsePositive("sizes", parts[0]), parsePositive("sizes", parts[1]), factor);
+            } else {
+                config.sizes.clear();
+                for (const auto& part : splitList(text, ',')) {
+                    config.sizes.push_back(parsePositive("sizes", part));
+                }
+            }
+            break;
+        }
+        case 'y':
+            if (!parseWireDtype(optarg, config.dtype)) {
+                std::cerr << "Unknown dtype: " << optarg << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'o':
+            config.operations.clear();
+            if (std::string(optarg) == "all") {
+                for (int op = 0; op < OP_COUNT; ++op) {
+                    config.operations.push_back(static_cast<MatrixOp>(op));
+                }
+                break;
+            }
+            for (const auto& part : splitList(optarg, ',')) {
+                MatrixOp op;
+                if (!MatrixOperation::parseOperation(part, op)) {
+                    std::cerr << "Unknown operation: " << part << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+                config.operations.push_back(op);
+            }
+            if (config.operations.empty()) {
+                config.operations.push_back(OP_SQUARE);
+            }
+            break;
+        case 'e':
+            config.densities.clear();
+            for (const auto& part : splitList(optarg, ',')) {
+                config.densities.push_back(parseFraction("density", part));
+            }
+            if (config.densities.empty()) {
+                config.densities.push_back(1.0);
+            }
+            break;
+        case 'z':
+            if (std::string(optarg) == "compare") {
+                config.compareEncodings = true;
+            } else {
+                config.sparseThreshold = parseFraction("sparse-threshold", optarg);
+            }
+            break;
+        case 'g':
+            if (std::string(optarg) == "auto") {
+                config.kernelCap = KERNEL_AVX512;
+            } else if (!parseKernelIsa(optarg, config.kernelCap)) {
+                std::cerr << "Unknown kernel: " << optarg << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'f':
+            if (!parseLaunchMode(optarg, config.launch)) {
+                std::cerr << "Unknown launch mode: " << optarg << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'v':
+            config.perf = true;
+            break;
+        case 'w':
+            config.warmup = parsePositive("warmup", optarg);
+            break;
+        case 'i':
+            config.iterations = std::max(1, parsePositive("iterations", optarg));
+            break;
+        case 'n':
+            config.window = std::max(1, parsePositive("window", optarg));
+            break;
+        case 'p':
+            if (std::string(optarg) == "cores") {
+                config.workers = static_cast<int>(IPCWorkerPool::defaultWorkerCount());
+            } else {
+                config.workers = parsePositive("workers", optarg);
+            }
+            break;
+        case 'b':
+            config.batch = parsePositive("batch", optarg);
+            break;
+        case 'd':
+            config.batchDelayUs = parsePositive("batch-delay", optarg);
+            break;
+        case 'x':
+            config.threads = parsePositive("threads", optarg);
+            if (config.threads > MAX_CALLER_THREADS) {
+                std::cerr << "--threads is at most " << MAX_CALLER_THREADS << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'a':
+            placementName = optarg;
+            break;
+        case 'u':
+            custom.parentCpu = parsePositive("parent-cpu", optarg);
+            break;
+        case 'k':
+            custom.childCpus.clear();
+            for (const auto& part : splitList(optarg, ',')) {
+                custom.childCpus.push_back(parsePositive("child-cpus", part));
+            }
+            break;
+        case 'm':
+            custom.numaNode = parsePositive("numa-node", optarg);
+            break;
+        case 'r':
+            config.seed = std::stoull(optarg);
+            break;
+        case 'c':
+            config.csvPath = optarg;
+            break;
+        case 'j':
+            config.jsonPath = optarg;
+            break;
+        case 'l':
+            for (const auto& name : availableIPCMethods()) {
+                std::cout << name << std::endl;
+            }
+            exit(EXIT_SUCCESS);
+        case 'h':
+            printUsage(argv[0]);
+            exit(EXIT_SUCCESS);
+        default:
+            printUsage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (config.transports.empty()) {
+        config.transports = availableIPCMethods();
+    }
+    for (const auto& name : config.transports) {
+        auto known = availableIPCMethods();
+        if (std::find(known.begin(), known.end(), name) == known.end()) {
+            std::cerr << "Unknown transport: " << name << " (use --list)" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int size : config.sizes) {
+        if (size < 1) {
+            std::cerr << "Matrix sizes must be at least 1" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (config.threads > 0 && config.batch > 0 && config.batchDelayUs == 0) {
+        // fewer callers than a batch never fill it, and nobody else flushes it
+        std::cerr << "--threads with --batch needs a --batch-delay above 0" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    config.placements = resolvePlacements(placementName, custom);
+    return config;
+}
+
+std::vector<int> Benchmark::geometricSizes(int minSize, int maxSize, double factor) {
+    std::vector<int> sizes;
+    for (double size = std::max(1, minSize); size < maxSize; size *= factor) {
+        int rounded = static_cast<int>(std::lround(size));
+        if (sizes.empty() || sizes.back() != rounded) {
+            sizes.push_back(rounded);
+        }
+    }
+    if (sizes.empty() || sizes.back() != maxSize) {
+        sizes.push_back(maxSize);
+    }
+    return sizes;
+}
+
+// nearest-rank percentile of an ascending sample
+double Benchmark::percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+    return sorted[rank - 1];
+}
+
+// cpu time consumed so far by this process (all threads), in microseconds
+static double ownCpuUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// cpu time consumed so far by the given child processes, in microseconds
+static double childCpuUs(const std::vector<pid_t>& pids) {
+    double total = 0;
+    for (pid_t pid : pids) {
+        clockid_t clock;
+        struct timespec ts;
+        if (clock_getcpuclockid(pid, &clock) == 0 && clock_gettime(clock, &ts) == 0) {
+            total += ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+        }
+    }
+    return total;
+}
+
+// cpu burned over the whole timed phase, so a child that spins between requests is charged
+// for it; the parent side includes preparing and verifying the matrices
+void Benchmark::startCpuSample(IPCMethod& method) {
+    cpuSample.parentUs = ownCpuUs();
+    cpuSample.childUs = childCpuUs(method.workerPids());
+}
+
+void Benchmark::finishCpuSample(IPCMethod& method, BenchmarkCell& cell) {
+    cell.parentCpuUs = (ownCpuUs() - cpuSample.parentUs) / config.iterations;
+    cell.childCpuUs = (childCpuUs(method.workerPids()) - cpuSample.childUs) / config.iterations;
+}
+
+// mean of a /proc/<pid>/status field (in kB) over the given processes
+static double meanStatusKb(const std::vector<pid_t>& pids, const std::string& field) {
+    double total = 0;
+    for (pid_t pid : pids) {
+        total += statusKb(pid, field);
+    }
+    return pids.empty() ? 0 : total / pids.size();
+}
+
+Benchmark::UsageSample Benchmark::sampleUsage(IPCMethod& method) const {
+    UsageSample sample;
+    sample.parent = selfCounters();
+    sample.children = processCounters(method.workerPids());
+    sample.pool = BufferPool::instance().stats();
+    if (parentPerf) {
+        sample.parentPerf = parentPerf->read();
+        sample.childPerf = childPerf->read();
+    }
+    return sample;
+}
+
+void Benchmark::addUsage(UsageSample& total, const UsageSample& before, const UsageSample& after) {
+    total.parent += after.parent - before.parent;
+    total.children += after.children - before.children;
+    total.pool.requests += after.pool.requests - before.pool.requests;
+    total.pool.allocated += after.pool.allocated - before.pool.allocated;
+    total.pool.oversize += after.pool.oversize - before.pool.oversize;
+    total.pool.reused += after.pool.reused - before.pool.reused;
+    auto addPerf = [](std::vector<double>& sum, const std::vector<double>& from, const std::vector<double>& to) {
+        sum.resize(to.size(), 0);
+        for (size_t event = 0; event < to.size(); ++event) {
+            sum[event] = to[event] < 0 ? -1 : sum[event] + to[event] - from[event];
+        }
+    };
+    addPerf(total.parentPerf, before.parentPerf, after.parentPerf);
+    addPerf(total.childPerf, before.childPerf, after.childPerf);
+}
+
+void Benchmark::finishUsage(IPCMethod& method, const UsageSample& total, size_t requests, BenchmarkCell& cell) const {
+    double n = std::max<size_t>(requests, 1);
+    cell.minorFaults = total.parent.minorFaults / n;
+    cell.majorFaults = total.parent.majorFaults / n;
+    cell.parentSwitches = total.parent.switches() / n;
+    cell.childMinorFaults = total.children.minorFaults / n;
+    cell.childMajorFaults = total.children.majorFaults / n;
+    cell.childSwitches = total.children.switches() / n;
+    cell.parentRssKb = statusKb(0, "VmRSS");
+    cell.poolRequests = total.pool.requests / n;
+    cell.poolAllocations = (total.pool.allocated + total.pool.oversize) / n;
+    cell.poolCachedKb = BufferPool::instance().stats().cachedBytes / 1024.0;
+    cell.childrenRssKb = 0;
+    for (pid_t pid : method.workerPids()) {
+        cell.childrenRssKb += statusKb(pid, "VmRSS");
+    }
+    for (size_t event = 0; event < total.parentPerf.size(); ++event) {
+        PerfCount count;
+        count.name = perfEventName(event);
+        count.parent = total.parentPerf[event] < 0 ? -1 : total.parentPerf[event] / n;
+        count.children = total.childPerf[event] < 0 ? -1 : total.childPerf[event] / n;
+        cell.perf.push_back(count);
+    }
+}
+
+// start the children and time them up to their first answer: initSubprocess alone returns
+// as soon as a child exists (a spawned one may still be loading), the first response only
+// once every piece of it is in place. the probe goes through the synchronous path, so it
+// lands on one child of a pool. the children are moved to their cpus before the probe, and
+// that step is left out of the time to first response
+LaunchSample Benchmark::launchTransport(IPCMethod& method, int workers, int threads, const Placement& placement) {
+    LaunchSample sample;
+    sample.transport = method.methodName();
+    sample.workers = workers;
+    sample.batch = config.batch;
+    sample.threads = threads;
+    sample.placement = placement.describe();
+    method.setLaunchMode(config.launch);
+    sample.mode = launchModeName(method.launchMode());
+
+    torch::Tensor probe = prepareMatrix(method, config.sizes.front(), 1.0);
+    auto start = std::chrono::steady_clock::now();
+    method.initSubprocess();
+    auto launched = std::chrono::steady_clock::now();
+    pinChildren(method, placement);
+    auto pinned = std::chrono::steady_clock::now();
+    method.sendAndReceiveV2(probe);
+    auto answered = std::chrono::steady_clock::now();
+
+    sample.launchUs = std::chrono::duration<double, std::micro>(launched - start).count();
+    sample.firstResponseUs = std::chrono::duration<double, std::micro>(answered - start - (pinned - launched)).count();
+    sample.childRssKb = meanStatusKb(method.workerPids(), "VmRSS");
+    std::cout << std::left << std::setw(24) << sample.transport << std::right << " " << std::setw(5) << sample.mode
+              << " launch " << std::fixed << std::setprecision(1) << std::setw(10) << sample.launchUs << " us"
+              << "  first response " << std::setw(10) << sample.firstResponseUs << " us"
+              << "  rss/child " << std::setw(8) << std::setprecision(0) << sample.childRssKb << " KiB" << std::endl;
+    return sample;
+}
+
+// worker or thread counts of a scaling sweep: 1, 2, 4 .. maxCount (always included)
+std::vector<int> Benchmark::scalingSweep(int maxCount) {
+    std::vector<int> counts;
+    for (int count = 1; count < maxCount; count *= 2) {
+        counts.push_back(count);
+    }
+    counts.push_back(maxCount);
+    return counts;
+}
+
+void Benchmark::run() {
+    cells.clear();
+    launches.clear();
+    setKernelIsa(config.kernelCap); // before any child is forked
+    sched_getaffinity(0, sizeof(unpinnedAffinity), &unpinnedAffinity);
+
+    for (const auto& placement : config.placements) {
+        // the memory policy must be set before a transport maps and touches its segment;
+        // the children inherit both it and the parent's affinity until pinChildren
+        // moves them
+        if (placement.numaNode >= 0) {
+            bindMemoryToNode(placement.numaNode);
+        }
+        if (placement.parentCpu >= 0) {
+            pinToCpu(0, placement.parentCpu);
+        }
+        // 0 = no pool / no submission queue
+        std::vector<int> workerCounts = config.workers == 0 ? std::vector<int>{0} : scalingSweep(config.workers);
+        std::vector<int> threadCounts = config.threads == 0 ? std::vector<int>{0} : scalingSweep(config.threads);
+        for (const auto& name : config.transports) {
+            // one transport at a time, so no other child competes for the cpu
+            for (int workers : workerCounts) {
+                for (int threads : threadCounts) {
+                    if (workers == 0) {
+                        runBatched(createIPCMethod(name), 1, threads, config.window, placement);
+                        continue;
+                    }
+                    auto pool = std::make_unique<IPCWorkerPool>([name] { return createIPCMethod(name); }, workers);
+                    // a pool only scales with requests in flight on every worker
+                    runBatched(std::move(pool), workers, threads, std::max(config.window, 2 * workers), placement);
+                }
+            }
+        }
+        sched_setaffinity(0, sizeof(unpinnedAffinity), &unpinnedAffinity);
+        if (placement.numaNode >= 0) {
+            bindMemoryToNode(-1);
+        }
+    }
+}
+
+// with --batch the transport sits behind a batcher, and the window has to hold a full batch.
+// with --threads the callers share it through a submission queue whose window holds a request
+// of every caller
+void Benchmark::runBatched(std::unique_ptr<IPCMethod> method, int workers, int threads, int window, const Placement& placement) {
+    if (config.batch > 0) {
+        BatchPolicy policy;
+        policy.maxTensors = config.batch;
+        policy.maxDelay = std::chrono::microseconds(config.batchDelayUs);
+        method = std::make_unique<IPCBatcher>(std::move(method), policy);
+        window = std::max(window, config.batch);
+    }
+    if (threads > 0) {
+        method = std::make_unique<IPCSubmissionQueue>(std::move(method));
+        window = std::max(window, threads);
+    }
+    runTransport(*method, workers, threads, window, placement);
+}
+
+// children are pinned round robin over the placement's cpus, in workerPids() order. without
+// child cpus they get the mask the parent had before its own pinning, which they inherited
+void Benchmark::pinChildren(IPCMethod& method, const Placement& placement) const {
+    auto pids = method.workerPids();
+    for (size_t i = 0; i < pids.size(); ++i) {
+        if (!placement.childCpus.empty()) {
+            pinToCpu(pids[i], placement.childCpus[i % placement.childCpus.size()]);
+        } else if (sched_setaffinity(pids[i], sizeof(unpinnedAffinity), &unpinnedAffinity) == -1) {
+            perror("sched_setaffinity");
+        }
+    }
+}
+
+// threshold above every density: encode whenever the encoding is smaller
+static const double SPARSE_ALWAYS = 2.0;
+
+static const char* encodingName(double threshold) {
+    if (threshold <= 0) {
+        return "dense";
+    }
+    return threshold > 1 ? "sparse" : "auto";
+}
+
+void Benchmark::runTransport(IPCMethod& method, int workers, int threads, int window, const Placement& placement) {
+    std::vector<double> thresholds{config.sparseThreshold};
+    if (config.compareEncodings) {
+        thresholds = {0, SPARSE_ALWAYS};
+    }
+    bool showDensity = config.densities.size() > 1 || config.densities.front() < 1 ||
+                       config.compareEncodings || config.sparseThreshold > 0;
+
+    LaunchSample sample = launchTransport(method, workers, std::max(threads, 1), placement);
+    size_t firstCell = cells.size();
+    if (config.perf) {
+        // the parent's counters follow this thread, the one issuing and timing the requests
+        // (with --threads the callers' and the queue's threads are left out)
+        parentPerf = std::make_unique<PerfCounters>(std::vector<pid_t>{0});
+        childPerf = std::make_unique<PerfCounters>(method.workerPids());
+        static bool warned = false;
+        if (!warned && !parentPerf->anyAvailable() && !childPerf->anyAvailable()) {
+            std::cerr << "perf_event_open is not permitted here (see /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+            warned = true;
+        }
+    }
+    for (MatrixOp op : config.operations) {
+        if (!method.supportsOperation(op)) {
+            std::cout << std::left << std::setw(24) << method.methodName() << std::right << " skips "
+                      << MatrixOperation::operation(op).name << ": its child only holds part of a matrix" << std::endl;
+            continue;
+        }
+        method.setOperation(op);
+        for (int size : config.sizes) {
+            for (double density : config.densities) {
+                for (double threshold : thresholds) {
+                    method.setSparseThreshold(threshold);
+                    cells.push_back(runCell(method, size, threads, window, density));
+                    auto& cell = cells.back();
+                    cell.encoding = encodingName(threshold);
+                    cell.workers = workers;
+                    cell.batch = config.batch;
+                    cell.threads = std::max(threads, 1);
+                    cell.placement = placement.describe();
+                    printCell(cell, placement, showDensity);
+                }
+            }
+        }
+    }
+    sample.childPeakRssKb = meanStatusKb(method.workerPids(), "VmHWM");
+    method.exitSubprocess();
+    parentPerf.reset();
+    childPerf.reset();
+    for (size_t i = firstCell; i < cells.size(); ++i) {
+        cells[i].launch = sample.mode;
+        cells[i].launchUs = sample.launchUs;
+        cells[i].firstResponseUs = sample.firstResponseUs;
+        cells[i].childRssKb = sample.childRssKb;
+        cells[i].childPeakRssKb = sample.childPeakRssKb;
+    }
+    launches.push_back(sample);
+}
+
+bool Benchmark::showOperation() const {
+    return config.operations.size() > 1 || config.operations.front() != OP_SQUARE;
+}
+
+void Benchmark::printCell(const BenchmarkCell& cell, const Placement& placement, bool showDensity) const {
+    std::cout << std::left << std::setw(24) << cell.transport << std::right
+              << " n=" << std::setw(5) << cell.size;
+    if (showOperation()) {
+        std::cout << " " << std::left << std::setw(9) << cell.op << std::right;
+    }
+    if (showDensity) {
+        std::cout << " density=" << std::fixed << std::setprecision(3) << cell.density
+                  << " " << std::left << std::setw(6) << cell.encoding << std::right;
+    }
+    if (config.workers > 0) {
+        std::cout << " workers=" << std::setw(3) << cell.workers;
+    }
+    if (config.batch > 0) {
+        std::cout << " batch=" << std::setw(3) << cell.batch;
+    }
+    if (config.threads > 0) {
+        std::cout << " threads=" << std::setw(2) << cell.threads;
+    }
+    if (config.placements.size() > 1 || placement.name != "unpinned") {
+        std::cout << " [" << cell.placement << "]";
+    }
+    std::cout << "  p50 " << std::setw(10) << std::fixed << std::setprecision(1) << cell.p50Us << " us"
+              << "  p99 " << std::setw(10) << cell.p99Us << " us"
+              << "  " << std::setw(9) << std::setprecision(1) << cell.mbps << " MB/s"
+              << "  " << std::setw(9) << cell.aggregateMbps << " agg MB/s"
+              << "  cpu " << std::setw(8) << cell.parentCpuUs << "+" << cell.childCpuUs << " us"
+              << "  faults " << std::setw(6) << cell.minorFaults + cell.majorFaults << "+"
+              << cell.childMinorFaults + cell.childMajorFaults
+              << (cell.errors ? "  VERIFICATION FAILED" : "") << std::endl;
+    for (const auto& phase : cell.phases) {
+        std::cout << "    " << std::left << std::setw(12) << phase.name << std::right
+                  << " p50 " << std::setw(10) << phase.p50Us << " us"
+                  << "  p99 " << std::setw(10) << phase.p99Us << " us" << std::endl;
+    }
+    if (cell.perf.empty()) {
+        return;
+    }
+    // per request, events the kernel doesn't expose left out
+    for (bool parent : {true, false}) {
+        std::cout << "    " << std::left << std::setw(12) << (parent ? "perf parent" : "perf child") << std::right;
+        for (const auto& count : cell.perf) {
+            double value = parent ? count.parent : count.children;
+            if (value >= 0) {
+                std::cout << "  " << count.name << " " << std::setprecision(1) << value;
+            }
+        }
+        std::cout << std::endl;
+    }
+}
+
+BenchmarkCell Benchmark::runCell(IPCMethod& method, int size, int threads, int window, double density) {
+    BenchmarkCell cell;
+    cell.transport = method.methodName();
+    cell.size = size;
+    cell.dtype = wireDtypeName(wireDtypeOf(config.dtype));
+    cell.density = density;
+    const MatrixOpInfo& op = MatrixOperation::operation(method.operation());
+    cell.op = op.name;
+    // the dense size either way, so MB/s compares encodings by the matrices they move
+    size_t elementSize = wireElementSize(wireDtypeOf(config.dtype));
+    std::vector<int64_t> shape{size, size};
+    cell.bytes = static_cast<size_t>(size) * size * elementSize;
+    cell.resultBytes = elementSize;
+    for (int64_t extent : op.resultShape(shape)) {
+        cell.resultBytes *= extent;
+    }
+    cell.intensity = MatrixOperation::arithmeticIntensity(method.operation(), shape, elementSize);
+    cell.iterations = config.iterations;
+
+    // same matrices for every transport and encoding at this size
+    torch::manual_seed(config.seed + size);
+
+    std::vector<double> latencies;
+    latencies.reserve(config.iterations);
+    method.resetPhaseStats();
+    UsageSample usage;
+    double timedSeconds = 0;
+
+    if (threads > 0) {
+        method.setMaxInFlight(window);
+        runConcurrent(method, size, threads, density, cell, latencies, usage, timedSeconds);
+    } else if (window > 1) {
+        runPipelined(method, size, window, density, cell, latencies, usage, timedSeconds);
+    } else {
+        for (int i = 0; i < config.warmup + config.iterations; ++i) {
+            if (i == config.warmup) {
+                startCpuSample(method);
+            }
+            auto matrix = prepareMatrix(method, size, density);
+
+            // sampled outside the timed window, so reading /proc doesn't count as latency
+            UsageSample usageBefore = sampleUsage(method);
+            auto start = std::chrono::steady_clock::now();
+
+            auto result = method.sendAndReceiveV2(matrix);
+
+            auto end = std::chrono::steady_clock::now();
+            UsageSample usageAfter = sampleUsage(method);
+
+            if (!op.verify(matrix, result)) {
+                ++cell.errors;
+            }
+            if (i < config.warmup) {
+                method.resetPhaseStats(); // phases only cover the timed requests
+                continue;
+            }
+            latencies.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+            timedSeconds += std::chrono::duration<double>(end - start).count();
+            addUsage(usage, usageBefore, usageAfter);
+        }
+        finishCpuSample(method, cell);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    cell.minUs = latencies.front();
+    cell.maxUs = latencies.back();
+    cell.p50Us = percentile(latencies, 50);
+    cell.p90Us = percentile(latencies, 90);
+    cell.p99Us = percentile(latencies, 99);
+    cell.p999Us = percentile(latencies, 99.9);
+    double sum = 0;
+    for (double latency : latencies) {
+        sum += latency;
+    }
+    cell.meanUs = sum / latencies.size();
+    cell.mbps = cell.bytes / (cell.p50Us / 1e6) / (1024 * 1024);
+    cell.window = std::max(1, window);
+    cell.aggregateMbps = cell.bytes * latencies.size() / timedSeconds / (1024 * 1024);
+    cell.requestsPerSecond = latencies.size() / timedSeconds;
+    finishUsage(method, usage, latencies.size(), cell);
+
+#ifdef IPC_ENABLE_PHASE_TIMING
+    for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+        const auto& histogram = method.phaseStats().histogram(phase);
+        PhaseSummary summary;
+        summary.name = phaseName(phase);
+        summary.count = histogram.count();
+        summary.meanUs = histogram.mean() / 1e3;
+        summary.p50Us = histogram.percentile(50) / 1e3;
+        summary.p99Us = histogram.percentile(99) / 1e3;
+        cell.phases.push_back(summary);
+    }
+#endif
+    return cell;
+}
+
+torch::Tensor Benchmark::prepareMatrix(IPCMethod& method, int size, double density) const {
+    auto matrix = method.allocateMatrix(size, size, config.dtype);
+    MatrixOperation::fillRandomMatrix(matrix);
+    MatrixOperation::sparsifyMatrix(matrix, density);
+    return matrix;
+}
+
+// keep up to 'window' requests outstanding through IPCMethod::submit. latency runs
+// from submit until the result is in the caller's hands; the warmup requests are drained
+// before the timed ones start so the phase histograms only cover the latter.
+void Benchmark::runPipelined(IPCMethod& method, int size, int window, double density, BenchmarkCell& cell,
+                             std::vector<double>& latencies, UsageSample& usage, double& timedSeconds) {
+    struct Pending {
+        torch::Tensor matrix;
+        std::future<torch::Tensor> result;
+        std::chrono::steady_clock::time_point start;
+    };
+    method.setMaxInFlight(window);
+    const MatrixOpInfo& op = MatrixOperation::operation(method.operation());
+
+    auto runRequests = [&](int count, bool timed) {
+        std::deque<Pending> pending;
+        auto finishOldest = [&]() {
+            Pending& oldest = pending.front();
+            torch::Tensor result = oldest.result.get();
+            auto end = std::chrono::steady_clock::now();
+            if (!op.verify(oldest.matrix, result)) {
+                ++cell.errors;
+            }
+            if (timed) {
+                latencies.push_back(std::chrono::duration<double, std::micro>(end - oldest.start).count());
+            }
+            pending.pop_front();
+        };
+
+        for (int i = 0; i < count; ++i) {
+            Pending request;
+            request.matrix = prepareMatrix(method, size, density);
+            request.start = std::chrono::steady_clock::now();
+            request.result = method.submit(request.matrix);
+            pending.push_back(std::move(request));
+            if (pending.size() >= static_cast<size_t>(window)) {
+                finishOldest();
+            }
+        }
+        while (!pending.empty()) {
+            finishOldest();
+        }
+    };
+
+    runRequests(config.warmup, false);
+    method.resetPhaseStats();
+
+    startCpuSample(method);
+    UsageSample usageBefore = sampleUsage(method);
+    auto start = std::chrono::steady_clock::now();
+    runRequests(config.iterations, true);
+    auto end = std::chrono::steady_clock::now();
+    UsageSample usageAfter = sampleUsage(method);
+    finishCpuSample(method, cell);
+    addUsage(usage, usageBefore, usageAfter);
+
+    timedSeconds = std::chrono::duration<double>(end - start).count();
+}
+
+// 'threads' callers share the transport, each sending its share of the requests one at a time
+// the way the request threads of a service would. every caller prepares its matrix up front
+// (the random generator is shared), warms up, and waits for the others before the timed
+// requests, so the timed phase sees all of them contending at once. latency is per request;
+// timedSeconds is the wall time until the last caller is done.
+void Benchmark::runConcurrent(IPCMethod& method, int size, int threads, double density, BenchmarkCell& cell,
+                              std::vector<double>& latencies, UsageSample& usage, double& timedSeconds) {
+    const MatrixOpInfo& op = MatrixOperation::operation(method.operation());
+    std::vector<torch::Tensor> matrices;
+    for (int caller = 0; caller < threads; ++caller) {
+        matrices.push_back(prepareMatrix(method, size, density));
+    }
+    std::vector<std::vector<double>> callerLatencies(threads);
+    std::vector<int> callerErrors(threads, 0);
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    int warmedUp = 0;
+    bool go = false;
+
+    auto caller = [&](int index) {
+        // warmup and timed requests spread as evenly as the counts allow
+        auto share = [&](int total) { return total / threads + (index < total % threads ? 1 : 0); };
+        const torch::Tensor& matrix = matrices[index];
+        auto send = [&]() {
+            auto start = std::chrono::steady_clock::now();
+            torch::Tensor result = method.sendAndReceiveV2(matrix);
+            auto end = std::chrono::steady_clock::now();
+            if (!op.verify(matrix, result)) {
+                ++callerErrors[index];
+            }
+            return std::chrono::duration<double, std::micro>(end - start).count();
+        };
+        for (int i = 0; i < share(config.warmup); ++i) {
+            send();
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ++warmedUp;
+            changed.notify_all();
+            changed.wait(lock, [&] { return go; });
+        }
+        int timed = share(config.iterations);
+        callerLatencies[index].reserve(timed);
+        for (int i = 0; i < timed; ++i) {
+            callerLatencies[index].push_back(send());
+        }
+    };
+
+    std::vector<std::thread> callers;
+    for (int index = 0; index < threads; ++index) {
+        callers.emplace_back(caller, index);
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return warmedUp == threads; });
+    }
+    method.resetPhaseStats();
+
+    startCpuSample(method);
+    UsageSample usageBefore = sampleUsage(method);
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        go = true;
+    }
+    changed.notify_all();
+    for (auto& thread : callers) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    UsageSample usageAfter = sampleUsage(method);
+    finishCpuSample(method, cell);
+    addUsage(usage, usageBefore, usageAfter);
+
+    for (int index = 0; index < threads; ++index) {
+        latencies.insert(latencies.end(), callerLatencies[index].begin(), callerLatencies[index].end());
+        cell.errors += callerErrors[index];
+    }
+    timedSeconds = std::chrono::duration<double>(end - start).count();
+}
+
+void Benchmark::printSummary() const {
+    std::cout << "\n" << std::left << std::setw(24) << "transport" << std::right
+              << std::setw(6) << "size" << std::setw(9) << "dtype" << std::setw(10) << "op" << std::setw(9) << "flop/B"
+              << std::setw(9) << "density" << std::setw(9) << "encoding"
+              << std::setw(11) << "min us" << std::setw(11) << "p50 us"
+              << std::setw(11) << "p90 us" << std::setw(11) << "p99 us" << std::setw(11) << "p99.9 us"
+              << std::setw(11) << "max us" << std::setw(11) << "MB/s" << std::setw(11) << "agg MB/s" << std::setw(11) << "req/s"
+              << std::setw(7) << "window" << std::setw(8) << "workers" << std::setw(6) << "batch" << std::setw(8) << "threads"
+              << std::setw(11) << "cpu us"
+              << std::setw(11) << "child cpu" << std::setw(9) << "faults" << std::setw(10) << "child flt"
+              << std::setw(7) << "csw" << std::setw(10) << "child csw" << std::setw(9) << "rss MiB" << std::setw(10) << "child MiB"
+              << std::setw(8) << "buffers" << std::setw(8) << "allocs"
+              << std::setw(7) << "errors" << "  placement" << std::endl;
+    for (const auto& cell : cells) {
+        std::cout << std::left << std::setw(24) << cell.transport << std::right
+                  << std::setw(6) << cell.size << std::setw(9) << cell.dtype << std::setw(10) << cell.op
+                  << std::fixed << std::setprecision(2) << std::setw(9) << cell.intensity << std::setprecision(3)
+                  << std::setw(9) << cell.density << std::setw(9) << cell.encoding << std::setprecision(1)
+                  << std::setw(11) << cell.minUs << std::setw(11) << cell.p50Us
+                  << std::setw(11) << cell.p90Us << std::setw(11) << cell.p99Us
+                  << std::setw(11) << cell.p999Us << std::setw(11) << cell.maxUs
+                  << std::setw(11) << cell.mbps << std::setw(11) << cell.aggregateMbps << std::setw(11) << cell.requestsPerSecond
+                  << std::setw(7) << cell.window << std::setw(8) << cell.workers << std::setw(6) << cell.batch
+                  << std::setw(8) << cell.threads
+                  << std::setw(11) << cell.parentCpuUs << std::setw(11) << cell.childCpuUs
+                  << std::setw(9) << cell.minorFaults + cell.majorFaults
+                  << std::setw(10) << cell.childMinorFaults + cell.childMajorFaults
+                  << std::setw(7) << cell.parentSwitches << std::setw(10) << cell.childSwitches
+                  << std::setw(9) << cell.parentRssKb / 1024 << std::setw(10) << cell.childrenRssKb / 1024
+                  << std::setw(8) << cell.poolRequests << std::setw(8) << std::setprecision(2) << cell.poolAllocations
+                  << std::setprecision(1)
+                  << std::setw(7) << cell.errors << "  " << cell.placement << std::endl;
+    }
+
+    printLaunches();
+    if (config.compareEncodings) {
+        printCrossover();
+    }
+    if (config.operations.size() > 1 && config.transports.size() > 1) {
+        printIntensity();
+    }
+    if (config.threads > 0) {
+        printCallerScaling();
+    }
+    if (config.workers == 0) {
+        return;
+    }
+    // aggregate throughput of every pool relative to the single worker pool of the same cell
+    std::cout << "\nScaling (aggregate MB/s, speedup over 1 worker)" << std::endl;
+    for (const auto& cell : cells) {
+        const BenchmarkCell* single = nullptr;
+        for (const auto& other : cells) {
+            if (other.transport == cell.transport && other.size == cell.size && other.op == cell.op &&
+                other.density == cell.density && other.encoding == cell.encoding && other.batch == cell.batch &&
+                other.placement == cell.placement && other.threads == cell.threads && other.workers == 1) {
+                single = &other;
+                break;
+            }
+        }
+        std::cout << std::left << std::setw(24) << cell.transport << std::right
+                  << std::setw(6) << cell.size << std::setw(4) << cell.workers << " workers"
+                  << std::setw(11) << std::fixed << std::setprecision(1) << cell.aggregateMbps;
+        if (single != nullptr && single->aggregateMbps > 0) {
+            std::cout << std::setw(8) << std::setprecision(2) << cell.aggregateMbps / single->aggregateMbps << "x";
+        }
+        std::cout << std::endl;
+    }
+}
+
+// per transport and size, the p50 of both encodings at every density and the highest density
+// at which the sparse one is still faster
+void Benchmark::printCrossover() const {
+    std::cout << "\nSparse crossover (p50 us dense / sparse)" << std::endl;
+    for (const auto& dense : cells) {
+        if (dense.encoding != "dense" || dense.density != config.densities.front()) {
+            continue; // one line per group, started by its first dense cell
+        }
+        auto sameGroup = [&](const BenchmarkCell& other) {
+            return other.transport == dense.transport && other.size == dense.size && other.workers == dense.workers &&
+                   other.batch == dense.batch && other.threads == dense.threads && other.placement == dense.placement;
+        };
+        std::cout << std::left << std::setw(24) << dense.transport << std::right << std::setw(6) << dense.size;
+        if (config.workers > 0) {
+            std::cout << std::setw(4) << dense.workers << " workers";
+        }
+        double crossover = -1;
+        for (const auto& denseCell : cells) {
+            if (!sameGroup(denseCell) || denseCell.encoding != "dense") {
+                continue;
+            }
+            for (const auto& sparseCell : cells) {
+                if (sameGroup(sparseCell) && sparseCell.encoding == "sparse" && sparseCell.density == denseCell.density) {
+                    std::cout << "  " << std::fixed << std::setprecision(3) << denseCell.density << ": "
+                              << std::setprecision(1) << denseCell.p50Us << "/" << sparseCell.p50Us;
+                    if (sparseCell.p50Us < denseCell.p50Us) {
+                        crossover = std::max(crossover, denseCell.density);
+                    }
+                }
+            }
+        }
+        if (crossover < 0) {
+            std::cout << "  -> dense always faster" << std::endl;
+        } else {
+            std::cout << "  -> sparse faster up to density " << std::setprecision(3) << crossover << std::endl;
+        }
+    }
+}
+
+// throughput and tail latency of every caller count relative to a single caller with the same
+// transport, size and pool
+void Benchmark::printCallerScaling() const {
+    std::cout << "\nCaller threads (requests/s and speedup over 1 thread, p99 / p99.9 us)" << std::endl;
+    for (const auto& cell : cells) {
+        const BenchmarkCell* single = nullptr;
+        for (const auto& other : cells) {
+            if (other.transport == cell.transport && other.size == cell.size && other.op == cell.op &&
+                other.density == cell.density && other.encoding == cell.encoding && other.workers == cell.workers &&
+                other.placement == cell.placement && other.threads == 1) {
+                single = &other;
+                break;
+            }
+        }
+        std::cout << std::left << std::setw(24) << cell.transport << std::right
+                  << std::setw(6) << cell.size << std::setw(4) << cell.threads << " threads";
+        if (config.workers > 0) {
+            std::cout << std::setw(4) << cell.workers << " workers";
+        }
+        std::cout << std::setw(12) << std::fixed << std::setprecision(0) << cell.requestsPerSecond;
+        if (single != nullptr && single->requestsPerSecond > 0) {
+            std::cout << std::setw(8) << std::setprecision(2) << cell.requestsPerSecond / single->requestsPerSecond << "x";
+        }
+        std::cout << std::setw(11) << std::setprecision(1) << cell.p99Us << std::setw(11) << cell.p999Us << std::endl;
+    }
+}
+
+// start-up cost and footprint of every run, so fork and spawn can be compared side by side
+void Benchmark::printLaunches() const {
+    std::cout << "\nLaunch (per run; rss per child)" << std::endl;
+    std::cout << std::left << std::setw(24) << "transport" << std::right << std::setw(8) << "workers"
+              << std::setw(8) << "threads" << std::setw(7) << "mode" << std::setw(12) << "launch us" << std::setw(12) << "first us"
+              << std::setw(10) << "rss KiB" << std::setw(10) << "peak KiB" << "  placement" << std::endl;
+    for (const auto& sample : launches) {
+        std::cout << std::left << std::setw(24) << sample.transport << std::right << std::setw(8) << sample.workers
+                  << std::setw(8) << sample.threads << std::setw(7) << sample.mode << std::fixed << std::setprecision(1)
+                  << std::setw(12) << sample.launchUs << std::setw(12) << sample.firstResponseUs << std::setprecision(0)
+                  << std::setw(10) << sample.childRssKb << std::setw(10) << sample.childPeakRssKb
+                  << "  " << sample.placement << std::endl;
+    }
+}
+
+// transports whose p50 lies within this share of the fastest one count as equally fast
+static const double TRANSPORT_SPREAD = 0.10;
+
+// per setting (op, size, density ...), every transport's p50 over the fastest one's, in order
+// of arithmetic intensity. where the spread stays within TRANSPORT_SPREAD the compute hides
+// the transfer and the choice of transport stops mattering
+void Benchmark::printIntensity() const {
+    auto sameSetting = [](const BenchmarkCell& a, const BenchmarkCell& b) {
+        return a.op == b.op && a.size == b.size && a.density == b.density && a.encoding == b.encoding &&
+               a.workers == b.workers && a.batch == b.batch && a.threads == b.threads && a.placement == b.placement;
+    };
+    struct Setting {
+        const BenchmarkCell* first;
+        double fastestUs;
+        double slowestUs;
+        bool evenlyFast() const { return slowestUs <= fastestUs * (1 + TRANSPORT_SPREAD); }
+    };
+    std::vector<Setting> settings;
+    for (const auto& cell : cells) {
+        auto known = std::find_if(settings.begin(), settings.end(),
+                                  [&](const Setting& setting) { return sameSetting(*setting.first, cell); });
+        if (known == settings.end()) {
+            settings.push_back({&cell, cell.p50Us, cell.p50Us});
+        } else {
+            known->fastestUs = std::min(known->fastestUs, cell.p50Us);
+            known->slowestUs = std::max(known->slowestUs, cell.p50Us);
+        }
+    }
+    std::stable_sort(settings.begin(), settings.end(), [](const Setting& a, const Setting& b) {
+        return a.first->intensity < b.first->intensity;
+    });
+
+    std::cout << "\nArithmetic intensity (p50 us of the fastest transport, the others relative to it)" << std::endl;
+    for (const auto& setting : settings) {
+        const BenchmarkCell& first = *setting.first;
+        std::cout << std::left << std::setw(10) << first.op << std::right << " n=" << std::setw(5) << first.size
+                  << std::fixed << std::setprecision(2) << std::setw(10) << first.intensity << " flop/B"
+                  << std::setprecision(1) << std::setw(11) << setting.fastestUs << " us";
+        for (const auto& cell : cells) {
+            if (sameSetting(cell, first)) {
+                std::cout << "  " << cell.transport << " " << std::setprecision(2) << cell.p50Us / setting.fastestUs << "x";
+            }
+        }
+        std::cout << (setting.evenlyFast() ? "  -> compute bound" : "  -> transport bound") << std::endl;
+    }
+
+    // lowest intensity from which on every setting is compute bound
+    double threshold = -1;
+    for (auto it = settings.rbegin(); it != settings.rend() && it->evenlyFast(); ++it) {
+        threshold = it->first->intensity;
+    }
+    if (threshold < 0) {
+        std::cout << "The transport still matters at the highest intensity measured" << std::endl;
+    } else {
+        std::cout << "Transports are within " << static_cast<int>(TRANSPORT_SPREAD * 100) << "% of each other from "
+                  << std::setprecision(2) << threshold << " flop/B on" << std::endl;
+    }
+}
+
+void Benchmark::writeCsv(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        perror(path.c_str());
+        return;
+    }
+    out << "transport,size,dtype,op,intensity,density,encoding,bytes,result_bytes,iterations,min_us,p50_us,p90_us,p99_us,p999_us,max_us,mean_us,"
+           "mbps,aggregate_mbps,requests_per_second,window,workers,batch,threads,placement,parent_cpu_us,child_cpu_us,minor_faults,major_faults,"
+           "parent_switches,child_minor_faults,child_major_faults,child_switches,parent_rss_kb,children_rss_kb,"
+           "pool_requests,pool_allocations,pool_cached_kb,errors,"
+           "launch,launch_us,first_response_us,child_rss_kb,child_peak_rss_kb";
+    if (!cells.empty()) {
+        for (const auto& phase : cells.front().phases) {
+            out << ',' << phase.name << "_p50_us," << phase.name << "_p99_us";
+        }
+        for (const auto& count : cells.front().perf) {
+            out << ",perf_" << count.name << "_parent,perf_" << count.name << "_children";
+        }
+    }
+    out << '\n';
+    out << std::fixed << std::setprecision(3);
+    for (const auto& cell : cells) {
+        out << cell.transport << ',' << cell.size << ',' << cell.dtype << ',' << cell.op << ',' << cell.intensity << ','
+            << cell.density << ',' << cell.encoding << ',' << cell.bytes << ',' << cell.resultBytes << ',' << cell.iterations << ','
+            << cell.minUs << ',' << cell.p50Us << ',' << cell.p90Us << ',' << cell.p99Us << ','
+            << cell.p999Us << ',' << cell.maxUs << ',' << cell.meanUs << ',' << cell.mbps << ','
+            << cell.aggregateMbps << ',' << cell.requestsPerSecond << ',' << cell.window << ',' << cell.workers << ','
+            << cell.batch << ',' << cell.threads << ",\"" << cell.placement << "\","
+            << cell.parentCpuUs << ',' << cell.childCpuUs << ',' << cell.minorFaults << ',' << cell.majorFaults << ','
+            << cell.parentSwitches << ',' << cell.childMinorFaults << ',' << cell.childMajorFaults << ',' << cell.childSwitches << ','
+            << cell.parentRssKb << ',' << cell.childrenRssKb << ','
+            << cell.poolRequests << ',' << cell.poolAllocations << ',' << cell.poolCachedKb << ',' << cell.errors << ','
+            << cell.launch << ',' << cell.launchUs << ',' << cell.firstResponseUs << ',' << cell.childRssKb << ',' << cell.childPeakRssKb;
+        for (const auto& phase : cell.phases) {
+            out << ',' << phase.p50Us << ',' << phase.p99Us;
+        }
+        for (const auto& count : cell.perf) {
+            out << ',' << count.parent << ',' << count.children;
+        }
+        out << '\n';
+    }
+}
+
+void Benchmark::writeJson(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        perror(path.c_str());
+        return;
+    }
+    out << std::fixed << std::setprecision(3);
+    out << "{\n  \"config\": {\"warmup\": " << config.warmup << ", \"iterations\": " << config.iterations
+        << ", \"dtype\": \"" << wireDtypeName(wireDtypeOf(config.dtype)) << "\""
+        << ", \"kernel\": \"" << kernelIsaName(kernelIsa()) << "\""
+        << ", \"launch\": \"" << launchModeName(config.launch) << "\""
+        << ", \"perf\": " << (config.perf ? "true" : "false")
+        << ", \"ops\": [";
+    for (size_t i = 0; i < config.operations.size(); ++i) {
+        out << (i ? ", " : "") << "\"" << MatrixOperation::operation(config.operations[i]).name << "\"";
+    }
+    out << "]"
+        << ", \"sparse_threshold\": " << (config.compareEncodings ? "\"compare\"" : std::to_string(config.sparseThreshold))
+        << ", \"window\": " << config.window << ", \"workers\": " << config.workers << ", \"batch\": " << config.batch
+        << ", \"batch_delay_us\": " << config.batchDelayUs << ", \"threads\": " << config.threads << ", \"seed\": " << config.seed << "},\n  \"results\": [\n";
+    for (size_t i = 0; i < cells.size(); ++i) {
+        const auto& cell = cells[i];
+        out << "    {\"transport\": \"" << cell.transport << "\", \"size\": " << cell.size
+            << ", \"dtype\": \"" << cell.dtype << "\", \"op\": \"" << cell.op << "\", \"intensity\": " << cell.intensity
+            << ", \"density\": " << cell.density
+            << ", \"encoding\": \"" << cell.encoding << "\", \"bytes\": " << cell.bytes << ", \"result_bytes\": " << cell.resultBytes
+            << ", \"iterations\": " << cell.iterations
+            << ", \"min_us\": " << cell.minUs << ", \"p50_us\": " << cell.p50Us
+            << ", \"p90_us\": " << cell.p90Us << ", \"p99_us\": " << cell.p99Us
+            << ", \"p999_us\": " << cell.p999Us << ", \"max_us\": " << cell.maxUs
+            << ", \"mean_us\": " << cell.meanUs << ", \"mbps\": " << cell.mbps
+            << ", \"aggregate_mbps\": " << cell.aggregateMbps << ", \"requests_per_second\": " << cell.requestsPerSecond
+            << ", \"window\": " << cell.window << ", \"workers\": " << cell.workers << ", \"batch\": " << cell.batch
+            << ", \"threads\": " << cell.threads << ", \"placement\": \"" << cell.placement << "\""
+            << ", \"parent_cpu_us\": " << cell.parentCpuUs
+            << ", \"child_cpu_us\": " << cell.childCpuUs
+            << ", \"minor_faults\": " << cell.minorFaults << ", \"major_faults\": " << cell.majorFaults
+            << ", \"parent_switches\": " << cell.parentSwitches << ", \"child_minor_faults\": " << cell.childMinorFaults
+            << ", \"child_major_faults\": " << cell.childMajorFaults << ", \"child_switches\": " << cell.childSwitches
+            << ", \"parent_rss_kb\": " << cell.parentRssKb << ", \"children_rss_kb\": " << cell.childrenRssKb
+            << ", \"pool_requests\": " << cell.poolRequests << ", \"pool_allocations\": " << cell.poolAllocations
+            << ", \"pool_cached_kb\": " << cell.poolCachedKb
+            << ", \"errors\": " << cell.errors
+            << ", \"launch\": \"" << cell.launch << "\", \"launch_us\": " << cell.launchUs
+            << ", \"first_response_us\": " << cell.firstResponseUs << ", \"child_rss_kb\": " << cell.childRssKb
+            << ", \"child_peak_rss_kb\": " << cell.childPeakRssKb << ", \"phases\": {";
+        for (size_t p = 0; p < cell.phases.size(); ++p) {
+            const auto& phase = cell.phases[p];
+            out << (p ? ", " : "") << "\"" << phase.name << "\": {\"count\": " << phase.count
+                << ", \"mean_us\": " << phase.meanUs << ", \"p50_us\": " << phase.p50Us
+                << ", \"p99_us\": " << phase.p99Us << "}";
+        }
+        out << "}, \"perf\": {";
+        for (size_t p = 0; p < cell.perf.size(); ++p) {
+            const auto& count = cell.perf[p];
+            // null where the kernel doesn't expose the event
+            auto value = [&](double v) { return v < 0 ? std::string("null") : std::to_string(v); };
+            out << (p ? ", " : "") << "\"" << count.name << "\": {\"parent\": " << value(count.parent)
+                << ", \"children\": " << value(count.children) << "}";
+        }
+        out << "}}" << (i + 1 < cells.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
@@ -0,0 +1,152 @@
+#include "ElementwiseKernels.h"
+#include "TensorWire.h"
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ELEMENTWISE_KERNELS_X86
+#endif
+
+template <typename T>
+using SquareFn = void (*)(const T* in, T* out, int64_t count);
+
+template <typename T>
+static void squareScalar(const T* in, T* out, int64_t count) {
+    for (int64_t i = 0; i < count; ++i) {
+        out[i] = static_cast<T>(in[i] * in[i]);
+    }
+}
+
+#ifdef ELEMENTWISE_KERNELS_X86
+// unaligned loads and stores: transport buffers only guarantee element alignment. the
+// scalar tail covers what is left of a chunk
+#define SQUARE_KERNEL(name, isa, T, VEC, WIDTH, LOAD, STORE) \
+    __attribute__((target(isa))) static void name(const T* in, T* out, int64_t count) { \
+        int64_t i = 0; \
+        for (; i + (WIDTH) <= count; i += (WIDTH)) { \
+            VEC v = LOAD; \
+            STORE; \
+        } \
+        for (; i < count; ++i) { \
+            out[i] = static_cast<T>(in[i] * in[i]); \
+        } \
+    }
+
+SQUARE_KERNEL(squareFloatSse2, "sse2", float, __m128, 4,
+              _mm_loadu_ps(in + i), _mm_storeu_ps(out + i, _mm_mul_ps(v, v)))
+SQUARE_KERNEL(squareFloatAvx2, "avx2", float, __m256, 8,
+              _mm256_loadu_ps(in + i), _mm256_storeu_ps(out + i, _mm256_mul_ps(v, v)))
+SQUARE_KERNEL(squareFloatAvx512, "avx512f", float, __m512, 16,
+              _mm512_loadu_ps(in + i), _mm512_storeu_ps(out + i, _mm512_mul_ps(v, v)))
+
+SQUARE_KERNEL(squareDoubleSse2, "sse2", double, __m128d, 2,
+              _mm_loadu_pd(in + i), _mm_storeu_pd(out + i, _mm_mul_pd(v, v)))
+SQUARE_KERNEL(squareDoubleAvx2, "avx2", double, __m256d, 4,
+              _mm256_loadu_pd(in + i), _mm256_storeu_pd(out + i, _mm256_mul_pd(v, v)))
+SQUARE_KERNEL(squareDoubleAvx512, "avx512f", double, __m512d, 8,
+              _mm512_loadu_pd(in + i), _mm512_storeu_pd(out + i, _mm512_mul_pd(v, v)))
+
+// SSE2 has no 32 bit low multiply (that is SSE4.1), so int32 starts at AVX2
+SQUARE_KERNEL(squareInt32Avx2, "avx2", int32_t, __m256i, 8,
+              _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)),
+              _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_mullo_epi32(v, v)))
+SQUARE_KERNEL(squareInt32Avx512, "avx512f", int32_t, __m512i, 16,
+              _mm512_loadu_si512(in + i), _mm512_storeu_si512(out + i, _mm512_mullo_epi32(v, v)))
+
+// 16 bit multiplies on 512 bit vectors need AVX-512BW; AVX2 is as far as int16 goes
+SQUARE_KERNEL(squareInt16Sse2, "sse2", int16_t, __m128i, 8,
+              _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)),
+              _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_mullo_epi16(v, v)))
+SQUARE_KERNEL(squareInt16Avx2, "avx2", int16_t, __m256i, 16,
+              _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i)),
+              _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_mullo_epi16(v, v)))
+
+#undef SQUARE_KERNEL
+#endif
+
+static KernelIsa detectKernelIsa() {
+#ifdef ELEMENTWISE_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return KERNEL_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return KERNEL_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return KERNEL_SSE2;
+    }
+#endif
+    return KERNEL_SCALAR;
+}
+
+static std::atomic<int> kernelIsaCap{KERNEL_ISA_COUNT - 1};
+
+KernelIsa supportedKernelIsa() {
+    static const KernelIsa supported = detectKernelIsa();
+    return supported;
+}
+
+KernelIsa kernelIsa() {
+    return static_cast<KernelIsa>(std::min<int>(supportedKernelIsa(), kernelIsaCap.load(std::memory_order_relaxed)));
+}
+
+void setKernelIsa(KernelIsa cap) {
+    kernelIsaCap.store(cap, std::memory_order_relaxed);
+}
+
+static const char* const KERNEL_ISA_NAMES[KERNEL_ISA_COUNT] = {"scalar", "sse2", "avx2", "avx512"};
+
+const char* kernelIsaName(KernelIsa isa) {
+    return isa >= 0 && isa < KERNEL_ISA_COUNT ? KERNEL_ISA_NAMES[isa] : "unknown";
+}
+
+bool parseKernelIsa(const std::string& name, KernelIsa& isa) {
+    for (int candidate = 0; candidate < KERNEL_ISA_COUNT; ++candidate) {
+        if (name == KERNEL_ISA_NAMES[candidate]) {
+            isa = static_cast<KernelIsa>(candidate);
+            return true;
+        }
+    }
+    return false;
+}
+
+// the widest kernel the isa allows; nullptr entries fall through to the next narrower one
+template <typename T>
+static void dispatchSquare(const void* in, void* out, int64_t count,
+                           SquareFn<T> avx512, SquareFn<T> avx2, SquareFn<T> sse2) {
+    const T* src = static_cast<const T*>(in);
+    T* dst = static_cast<T*>(out);
+    KernelIsa isa = kernelIsa();
+    if (isa >= KERNEL_AVX512 && avx512 != nullptr) {
+        avx512(src, dst, count);
+    } else if (isa >= KERNEL_AVX2 && avx2 != nullptr) {
+        avx2(src, dst, count);
+    } else if (isa >= KERNEL_SSE2 && sse2 != nullptr) {
+        sse2(src, dst, count);
+    } else {
+        squareScalar(src, dst, count);
+    }
+}
+
+void squareElements(const void* in, void* out, int64_t count, uint8_t dtype) {
+#ifdef ELEMENTWISE_KERNELS_X86
+    switch (dtype) {
+    case WIRE_FLOAT32:
+        return dispatchSquare<float>(in, out, count, squareFloatAvx512, squareFloatAvx2, squareFloatSse2);
+    case WIRE_FLOAT64:
+        return dispatchSquare<double>(in, out, count, squareDoubleAvx512, squareDoubleAvx2, squareDoubleSse2);
+    case WIRE_INT32:
+        return dispatchSquare<int32_t>(in, out, count, squareInt32Avx512, squareInt32Avx2, nullptr);
+    case WIRE_INT16:
+        return dispatchSquare<int16_t>(in, out, count, nullptr, squareInt16Avx2, squareInt16Sse2);
+    default:
+        break;
+    }
+#endif
+    visitWireDtype(dtype, [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        squareScalar(static_cast<const T*>(in), static_cast<T*>(out), count);
+    });
+}
@@ -0,0 +1,86 @@
+#include "AsyncCompletions.h"
+#include "PhaseTimer.h"
+#include <algorithm>
+#include <iostream>
+
+AsyncCompletions::~AsyncCompletions() {
+    drain();
+}
+
+uint64_t AsyncCompletions::begin(std::future<torch::Tensor>& future, const torch::Tensor& buffer,
+                                 size_t window, const ReceiveFn& receiveOne) {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&] { return requests.size() < std::max<size_t>(window, 1); });
+
+    uint64_t requestId = nextId++;
+    Request& request = requests[requestId];
+    request.buffer = buffer;
+    request.submittedNs = phaseClockNs();
+    future = request.promise.get_future();
+
+    if (!completionThread.joinable()) {
+        stopping = false;
+        completionThread = std::thread(&AsyncCompletions::completionLoop, this, receiveOne);
+    }
+    changed.notify_all();
+    return requestId;
+}
+
+void AsyncCompletions::complete(uint64_t requestId, const torch::Tensor& result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    find(requestId).promise.set_value(result);
+    requests.erase(requestId);
+    changed.notify_all();
+}
+
+torch::Tensor AsyncCompletions::buffer(uint64_t requestId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return find(requestId).buffer;
+}
+
+uint64_t AsyncCompletions::submittedNs(uint64_t requestId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return find(requestId).submittedNs;
+}
+
+AsyncCompletions::Request& AsyncCompletions::find(uint64_t requestId) {
+    auto it = requests.find(requestId);
+    if (it == requests.end()) {
+        std::cerr << "Async: result for unknown request " << requestId << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return it->second;
+}
+
+void AsyncCompletions::drain() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!completionThread.joinable()) {
+            return;
+        }
+        changed.wait(lock, [&] { return requests.empty(); });
+        stopping = true;
+        changed.notify_all();
+    }
+    completionThread.join();
+}
+
+size_t AsyncCompletions::inFlight() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return requests.size();
+}
+
+// only reads from the channel while a result is owed, so it never sits in a blocking read
+// when drain() stops it
+void AsyncCompletions::completionLoop(ReceiveFn receiveOne) {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return !requests.empty() || stopping; });
+            if (requests.empty()) {
+                return; // stopping with nothing owed
+            }
+        }
+        receiveOne();
+    }
+}
@@ -0,0 +1,124 @@
+#include "BufferPool.h"
+#include "debug.h"
+#include <pthread.h>
+#include <sys/mman.h>
+
+// bytes of free buffers kept per class; the largest classes still keep two, enough for a
+// request and its result
+static const size_t CLASS_CACHE_BYTES = 64 * 1024 * 1024;
+
+BufferPool& BufferPool::instance() {
+    // never destroyed: tensors released during static destruction still find their pool
+    static BufferPool* pool = new BufferPool();
+    return *pool;
+}
+
+BufferPool::BufferPool() {
+    // a fork while another thread holds the lock would leave it held in the child forever.
+    // the child starts with empty free lists: the cached buffers are wiped in it anyway
+    pthread_atfork([] { instance().mutex.lock(); },
+                   [] { instance().mutex.unlock(); },
+                   [] {
+                       instance().mutex.unlock();
+                       instance().trim();
+                   });
+}
+
+size_t BufferPool::classCapacity(int sizeClass) {
+    return std::max<size_t>(2, CLASS_CACHE_BYTES / classBytes(sizeClass));
+}
+
+torch::Tensor BufferPool::empty(at::IntArrayRef sizes, torch::ScalarType dtype) {
+    std::vector<int64_t> strides(sizes.size());
+    int64_t elements = 1;
+    for (int64_t dim = static_cast<int64_t>(sizes.size()) - 1; dim >= 0; --dim) {
+        strides[dim] = elements;
+        elements *= sizes[dim];
+    }
+    return acquire(elements * torch::elementSize(dtype), sizes, strides, dtype);
+}
+
+torch::Tensor BufferPool::emptyStrided(at::IntArrayRef sizes, at::IntArrayRef strides, torch::ScalarType dtype) {
+    size_t elements = 1;
+    for (int64_t extent : sizes) {
+        elements *= extent;
+    }
+    return acquire(elements * torch::elementSize(dtype), sizes, strides, dtype);
+}
+
+torch::Tensor BufferPool::acquire(size_t bytes, at::IntArrayRef sizes, at::IntArrayRef strides, torch::ScalarType dtype) {
+    int sizeClass = 0;
+    while (sizeClass < CLASS_COUNT && classBytes(sizeClass) < bytes) {
+        ++sizeClass;
+    }
+    auto options = torch::TensorOptions().dtype(dtype);
+    if (sizeClass == CLASS_COUNT) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++counts.requests;
+        ++counts.oversize;
+        return torch::empty_strided(sizes, strides, options);
+    }
+
+    void* buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++counts.requests;
+        if (!freeLists[sizeClass].empty()) {
+            buffer = freeLists[sizeClass].back();
+            freeLists[sizeClass].pop_back();
+            counts.cachedBytes -= classBytes(sizeClass);
+            ++counts.reused;
+        } else {
+            ++counts.allocated;
+        }
+    }
+    if (buffer == nullptr) {
+        // MAP_POPULATE faults every page in now instead of on the first receive into it
+        buffer = mmap(nullptr, classBytes(sizeClass), PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (buffer == MAP_FAILED) {
+            perror("mmap");
+            exit(EXIT_FAILURE);
+        }
+#ifdef MADV_WIPEONFORK
+        // otherwise every fork of a transport child turns the cached buffers into copy on
+        // write pages, and the parent's next receive into one takes a fault per page again
+        if (madvise(buffer, classBytes(sizeClass), MADV_WIPEONFORK) == -1) {
+            DEBUG_PRINT(1, "BufferPool: MADV_WIPEONFORK unavailable, buffers stay shared across fork\n");
+        }
+#endif
+        DEBUG_PRINT(2, "BufferPool: Mapped a " << classBytes(sizeClass) << " byte buffer\n");
+    }
+    return torch::from_blob(buffer, sizes, strides,
+                            [sizeClass](void* data) { instance().release(data, sizeClass); }, options);
+}
+
+void BufferPool::release(void* buffer, int sizeClass) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (freeLists[sizeClass].size() < classCapacity(sizeClass)) {
+            freeLists[sizeClass].push_back(buffer);
+            counts.cachedBytes += classBytes(sizeClass);
+            return;
+        }
+        ++counts.released;
+    }
+    munmap(buffer, classBytes(sizeClass));
+}
+
+BufferPoolStats BufferPool::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counts;
+}
+
+void BufferPool::trim() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int sizeClass = 0; sizeClass < CLASS_COUNT; ++sizeClass) {
+        for (void* buffer : freeLists[sizeClass]) {
+            munmap(buffer, classBytes(sizeClass));
+        }
+        counts.released += freeLists[sizeClass].size();
+        freeLists[sizeClass].clear();
+    }
+    counts.cachedBytes = 0;
+}
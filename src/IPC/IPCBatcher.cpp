@@ -0,0 +1,197 @@
+#include "IPCBatcher.h"
+#include <cmath>
+
+IPCBatcher::IPCBatcher(std::unique_ptr<IPCMethod> inner, BatchPolicy policy)
+    : inner(std::move(inner)), policy(policy) {
+    if (this->policy.maxTensors == 0) {
+        this->policy.maxTensors = 1;
+    }
+    DEBUG_PRINT(1, "Batcher: up to " << this->policy.maxTensors << " matrices per "
+                << this->inner->methodName() << " request\n");
+}
+
+IPCBatcher::~IPCBatcher() {
+    stopFlushThread();
+}
+
+void IPCBatcher::initSubprocess() {
+    inner->initSubprocess();
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = false;
+    flushThread = std::thread(&IPCBatcher::flushLoop, this);
+}
+
+void IPCBatcher::exitSubprocess() {
+    stopFlushThread();
+    inner->exitSubprocess();
+}
+
+void IPCBatcher::stopFlushThread() {
+    flush();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!flushThread.joinable()) {
+            return;
+        }
+        changed.wait(lock, [&] { return inFlight.empty(); });
+        stopping = true;
+        changed.notify_all();
+    }
+    flushThread.join();
+}
+
+std::future<torch::Tensor> IPCBatcher::submit(const torch::Tensor& matrix) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (outstanding >= maxInFlight()) {
+        // the matrices holding up the window may still be pending
+        flushLocked(lock);
+        changed.wait(lock, [&] { return outstanding < maxInFlight(); });
+    }
+    if (!pending.inputs.empty() && pending.dtype != matrix.scalar_type()) {
+        flushLocked(lock); // one carrier holds one dtype
+    }
+    if (pending.inputs.empty()) {
+        pending.deadline = std::chrono::steady_clock::now() + policy.maxDelay;
+        pending.dtype = matrix.scalar_type();
+    }
+    pending.inputs.push_back(matrix.contiguous());
+    pending.promises.emplace_back();
+    pending.bytes += matrix.numel() * matrix.element_size();
+    std::future<torch::Tensor> future = pending.promises.back().get_future();
+    ++outstanding;
+
+    if (pending.inputs.size() >= policy.maxTensors || pending.bytes >= policy.maxBytes) {
+        flushLocked(lock);
+    } else {
+        changed.notify_all(); // the flush thread may need to pick up a new deadline
+    }
+    return future;
+}
+
+torch::Tensor IPCBatcher::sendAndReceiveV2(const torch::Tensor& matrix) {
+    std::future<torch::Tensor> result = submit(matrix);
+    flush(); // nobody else is going to fill the batch
+    return result.get();
+}
+
+void IPCBatcher::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    flushLocked(lock);
+}
+
+void IPCBatcher::setOperation(MatrixOp op) {
+    flush();
+    IPCMethod::setOperation(op);
+    std::lock_guard<std::mutex> submitLock(submitMutex);
+    inner->setOperation(op);
+}
+
+// packing and the inner submit run without the lock, so callers keep filling the next batch
+void IPCBatcher::flushLocked(std::unique_lock<std::mutex>& lock) {
+    if (pending.inputs.empty()) {
+        return;
+    }
+    Batch batch = std::move(pending);
+    pending = Batch();
+    lock.unlock();
+    {
+        std::lock_guard<std::mutex> submitLock(submitMutex);
+        torch::Tensor carrier = pack(batch);
+        batch.result = inner->submit(carrier);
+        DEBUG_PRINT(2, "Batcher: flushed " << batch.shapes.size() << " matrices in a " << carrier.size(0) << "^2 carrier\n");
+        lock.lock();
+        inFlight.push_back(std::move(batch));
+    }
+    changed.notify_all();
+}
+
+// smallest square carrier that holds every matrix back to back; the tail is zeroed
+torch::Tensor IPCBatcher::pack(Batch& batch) {
+    uint64_t elements = 0;
+    for (const auto& input : batch.inputs) {
+        ShapeEntry entry;
+        entry.offset = elements;
+        entry.shape = input.sizes().vec();
+        batch.shapes.push_back(entry);
+        elements += input.numel();
+    }
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(elements))));
+    torch::Tensor carrier = inner->allocateMatrix(side, side, batch.dtype);
+    torch::Tensor flat = carrier.view({-1});
+    for (size_t i = 0; i < batch.inputs.size(); ++i) {
+        flat.narrow(0, batch.shapes[i].offset, batch.inputs[i].numel()).copy_(batch.inputs[i].view({-1}));
+    }
+    uint64_t capacity = static_cast<uint64_t>(side) * side;
+    if (elements < capacity) {
+        flat.narrow(0, elements, capacity - elements).zero_();
+    }
+    batch.inputs.clear();
+    return carrier;
+}
+
+// every result is a view into the carrier result, no copy. if the carrier failed, every
+// matrix of the batch that has no result yet gets its exception
+void IPCBatcher::complete(Batch& batch) {
+    size_t done = 0;
+    try {
+        torch::Tensor flat = batch.result.get().reshape({-1});
+        for (; done < batch.shapes.size(); ++done) {
+            const ShapeEntry& entry = batch.shapes[done];
+            int64_t elements = 1;
+            for (int64_t size : entry.shape) {
+                elements *= size;
+            }
+            batch.promises[done].set_value(flat.narrow(0, entry.offset, elements).view(entry.shape));
+        }
+    } catch (...) {
+        for (; done < batch.shapes.size(); ++done) {
+            batch.promises[done].set_exception(std::current_exception());
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    outstanding -= batch.shapes.size();
+    changed.notify_all();
+}
+
+// flushes the pending batch when its deadline passes and completes batches in order. while
+// a batch is in flight it wakes at least every maxDelay to check the pending one.
+void IPCBatcher::flushLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    bool deadlines = policy.maxDelay.count() > 0;
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        if (deadlines && !pending.inputs.empty() && now >= pending.deadline) {
+            flushLocked(lock);
+            continue;
+        }
+        if (!inFlight.empty()) {
+            std::future<torch::Tensor>& result = inFlight.front().result; // only this thread pops
+            auto wakeUp = pending.inputs.empty() ? now + policy.maxDelay : pending.deadline;
+            lock.unlock();
+            bool ready = deadlines ? result.wait_until(wakeUp) == std::future_status::ready
+                                   : (result.wait(), true);
+            lock.lock();
+            if (ready) {
+                Batch batch = std::move(inFlight.front());
+                inFlight.pop_front();
+                lock.unlock();
+                complete(batch);
+                lock.lock();
+            }
+            continue;
+        }
+        if (stopping) {
+            return;
+        }
+        if (deadlines && !pending.inputs.empty()) {
+            changed.wait_until(lock, pending.deadline);
+        } else {
+            changed.wait(lock);
+        }
+    }
+}
+
+size_t IPCBatcher::outstandingRequests() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return outstanding;
+}
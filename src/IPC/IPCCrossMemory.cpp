@@ -0,0 +1,298 @@
+#include "IPCCrossMemory.h"
+#include "BufferPool.h"
+#include "MatrixOperation.h"
+#include <atomic>
+#include <iostream>
+#include <errno.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/uio.h> // for process_vm_readv / process_vm_writev
+#include <sys/wait.h>
+#include <unistd.h>
+
+// CrossMemory children alive in this process; Yama keeps a single ptracer exception per process
+static std::atomic<int> crossMemoryChildren{0};
+
+// returns false once the other side has gone away
+static bool readFull(int fd, void* data, size_t bytes) {
+    char* out = static_cast<char*>(data);
+    size_t done = 0;
+    while (done < bytes) {
+        ssize_t bytesRead = read(fd, out + done, bytes - done);
+        if (bytesRead == -1 && errno == EINTR) {
+            continue;
+        }
+        if (bytesRead == -1) {
+            perror("read");
+        }
+        if (bytesRead <= 0) {
+            return false;
+        }
+        done += bytesRead;
+    }
+    return true;
+}
+
+// descriptors and responses are smaller than PIPE_BUF, so they go out in one write
+static void writeMessage(int fd, const void* data, size_t bytes) {
+    if (write(fd, data, bytes) != static_cast<ssize_t>(bytes)) {
+        perror("write");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// one copy between this process and 'pid', in either direction. a transfer stops short at
+// the first page it can't access, so the rest is retried from there; returns 0 or errno
+static int crossMemoryCopy(pid_t pid, void* local, uint64_t remote, size_t bytes, bool toRemote) {
+    size_t done = 0;
+    while (done < bytes) {
+        struct iovec localIov = {static_cast<char*>(local) + done, bytes - done};
+        struct iovec remoteIov = {reinterpret_cast<void*>(remote + done), bytes - done};
+        ssize_t moved = toRemote ? process_vm_writev(pid, &localIov, 1, &remoteIov, 1, 0)
+                                 : process_vm_readv(pid, &localIov, 1, &remoteIov, 1, 0);
+        if (moved == -1 && errno == EINTR) {
+            continue;
+        }
+        if (moved == -1) {
+            return errno;
+        }
+        if (moved == 0) {
+            return EFAULT;
+        }
+        done += moved;
+    }
+    return 0;
+}
+
+IPCCrossMemory::IPCCrossMemory() {
+    if (pipe(requestPipe) == -1 || pipe(responsePipe) == -1) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+}
+
+IPCCrossMemory::~IPCCrossMemory() {
+    for (int fd : {requestPipe[0], requestPipe[1], responsePipe[0], responsePipe[1]}) {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+    if (childPid > 0) {
+        waitpid(childPid, nullptr, 0);
+        revokeChildAccess();
+    }
+}
+
+void IPCCrossMemory::initSubprocess() {
+    if (spawnsWorker()) {
+        // the worker gets the child's ends; the parent's ends stay out of it
+        closeOnExec(requestPipe[1]);
+        closeOnExec(responsePipe[0]);
+        childPid = spawnWorker(methodName(), {{"request", std::to_string(requestPipe[0])},
+                                              {"response", std::to_string(responsePipe[1])}});
+        allowChildAccess();
+        return;
+    }
+    childPid = fork();
+    if (childPid == -1) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    } else if (childPid == 0) { // child process
+        close(requestPipe[1]);  // so a parent that goes away ends the loop
+        close(responsePipe[0]);
+        serveRequests();
+        exit(0);
+    }
+    allowChildAccess();
+}
+
+// process_vm_readv/writev need ptrace access to the parent. with Yama ptrace_scope 1 a child
+// has none until the parent names it its ptracer, which it does before sending any request.
+// there is one such exception per process, so from a second child on (a worker pool) it is
+// opened to every process of this user until the last child is gone. without Yama the call
+// fails and isn't needed.
+void IPCCrossMemory::allowChildAccess() {
+    unsigned long tracer = crossMemoryChildren++ == 0 ? static_cast<unsigned long>(childPid) : PR_SET_PTRACER_ANY;
+    if (prctl(PR_SET_PTRACER, tracer, 0, 0, 0) == -1) {
+        DEBUG_PRINT(1, "CrossMemory: PR_SET_PTRACER: " << strerror(errno) << "\n");
+    }
+}
+
+// once the last child is reaped, nobody may ptrace this process any more
+void IPCCrossMemory::revokeChildAccess() {
+    if (--crossMemoryChildren == 0 && prctl(PR_SET_PTRACER, 0, 0, 0, 0) == -1) {
+        DEBUG_PRINT(1, "CrossMemory: PR_SET_PTRACER: " << strerror(errno) << "\n");
+    }
+}
+
+// worker: the pipes the constructor made go, the inherited ones are served in their place
+void IPCCrossMemory::serveWorker(const ChannelArguments& args) {
+    close(requestPipe[0]); close(requestPipe[1]);
+    close(responsePipe[0]); close(responsePipe[1]);
+    requestPipe[0] = channelNumber(args, "request");
+    responsePipe[1] = channelNumber(args, "response");
+    requestPipe[1] = responsePipe[0] = -1;
+    serveRequests();
+}
+
+// child: requests are served strictly in order, each straight from and into the parent's memory
+void IPCCrossMemory::serveRequests() {
+    pid_t parent = getppid();
+    CrossMemoryRequest request;
+    while (readFull(requestPipe[0], &request, sizeof(request)) && request.command != CMA_EXIT) {
+        if (request.command != CMA_PROCESS) {
+            continue;
+        }
+        IPC_PHASE_TIMES(childTimes);
+        IPC_PHASE_MARK_WAKE(childTimes);
+        CrossMemoryResponse response = {};
+        response.requestId = request.requestId;
+        torch::Tensor payload;
+        if (!validWireHeader(request.header)) {
+            response.error = EINVAL; // the parent still waits for an answer
+        } else {
+            IPC_PHASE_START(readStart);
+            payload = emptyFromWire(request.header);
+            response.error = crossMemoryCopy(parent, payload.data_ptr(), request.source,
+                                             wirePayloadBytes(request.header), false);
+            IPC_PHASE_ADD(childTimes, PHASE_CHILD_READ, readStart);
+        }
+
+        if (response.error == 0) {
+            IPC_PHASE_START(computeStart);
+            TensorWireHeader header = request.header;
+            // the parent's result buffer is contiguous, so is what goes into it
+            torch::Tensor result = MatrixOperation::applyPayload(payload, header).contiguous();
+            response.header = describeTensor(result);
+            response.header.op = request.header.op;
+            IPC_PHASE_ADD(childTimes, PHASE_COMPUTE, computeStart);
+
+            IPC_PHASE_START(writeStart);
+            size_t bytes = wirePayloadBytes(response.header);
+            response.error = bytes > request.targetBytes
+                ? EMSGSIZE
+                : crossMemoryCopy(parent, result.data_ptr(), request.target, bytes, true);
+            IPC_PHASE_ADD(childTimes, PHASE_CHILD_WRITE, writeStart);
+        }
+        writeMessage(responsePipe[1], &response, sizeof(response));
+#ifdef IPC_ENABLE_PHASE_TIMING
+        // ship the child's phase times back behind the response
+        writeMessage(responsePipe[1], &childTimes, sizeof(childTimes));
+#endif
+        DEBUG_PRINT(1, "CrossMemory: Child served request " << request.requestId << "\n");
+    }
+}
+
+// the dense payload the child reads and the result buffer it writes, both in this process
+torch::Tensor IPCCrossMemory::prepareRequest(const torch::Tensor& matrix, TensorWireHeader& header, torch::Tensor& result) const {
+    torch::Tensor payload = matrix.contiguous();
+    header = describeTensor(payload);
+    header.op = operation();
+    std::vector<int64_t> shape = MatrixOperation::operation(operation()).resultShape(payload.sizes());
+    result = BufferPool::instance().empty(shape, payload.scalar_type());
+    return payload;
+}
+
+void IPCCrossMemory::sendRequest(const torch::Tensor& payload, const TensorWireHeader& header,
+                                 const torch::Tensor& result, uint64_t requestId) {
+    CrossMemoryRequest request = {};
+    request.command = CMA_PROCESS;
+    request.requestId = requestId;
+    request.source = reinterpret_cast<uint64_t>(payload.data_ptr());
+    request.target = reinterpret_cast<uint64_t>(result.data_ptr());
+    request.targetBytes = result.numel() * result.element_size();
+    request.header = header;
+    writeMessage(requestPipe[1], &request, sizeof(request));
+    DEBUG_PRINT(1, "CrossMemory: Parent sent descriptor of request " << requestId << "\n");
+}
+
+// the next response, and the child's phase times behind it; by then the result is in place
+CrossMemoryResponse IPCCrossMemory::receiveResponse(PhaseTimes& childTimes) {
+    CrossMemoryResponse response;
+    if (!readFull(responsePipe[0], &response, sizeof(response))) {
+        std::cerr << "Error: Did not read a response from the CrossMemory child." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+#ifdef IPC_ENABLE_PHASE_TIMING
+    if (!readFull(responsePipe[0], &childTimes, sizeof(childTimes))) {
+        childTimes.clear();
+    }
+#endif
+    if (response.error != 0) {
+        std::cerr << "Error: CrossMemory child could not transfer request " << response.requestId << ": "
+                  << strerror(response.error);
+        if (response.error == EPERM) {
+            std::cerr << " (ptrace access to the parent is denied, see /proc/sys/kernel/yama/ptrace_scope)";
+        }
+        std::cerr << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return response;
+}
+
+torch::Tensor IPCCrossMemory::sendAndReceiveV2(const torch::Tensor& matrix) {
+    completions.drain(); // the synchronous path reads the response pipe itself
+    PhaseTimes childTimes;
+    IPC_PHASE_TIMES(parentTimes);
+    IPC_PHASE_START(requestStart);
+
+    // payload and result stay untouched until the child is done with them because we block
+    // on the response below
+    TensorWireHeader header;
+    torch::Tensor result;
+    torch::Tensor payload = prepareRequest(matrix, header, result);
+    sendRequest(payload, header, result, 0);
+    IPC_PHASE_ADD(parentTimes, PHASE_WRITE, requestStart);
+
+    IPC_PHASE_START(readStart);
+    receiveResponse(childTimes);
+    IPC_PHASE_ADD(parentTimes, PHASE_READ, readStart);
+
+    IPC_PHASE_COMMIT(phases, parentTimes);
+#ifdef IPC_ENABLE_PHASE_TIMING
+    phases.recordChild(childTimes, requestStart);
+#endif
+    return result;
+}
+
+std::future<torch::Tensor> IPCCrossMemory::submit(const torch::Tensor& matrix) {
+    TensorWireHeader header;
+    torch::Tensor result;
+    torch::Tensor payload = prepareRequest(matrix, header, result);
+    std::future<torch::Tensor> future;
+    // the result stays pinned as the request's buffer, the payload in sentRequests, until the
+    // child has answered
+    uint64_t requestId = completions.begin(future, result, maxInFlight(), [this] { completeOneRequest(); });
+    {
+        std::lock_guard<std::mutex> lock(sentMutex);
+        sentRequests.push_back(payload);
+    }
+    sendRequest(payload, header, result, requestId);
+    return future;
+}
+
+// completion thread: responses come back in the order the requests were sent
+void IPCCrossMemory::completeOneRequest() {
+    PhaseTimes childTimes;
+    CrossMemoryResponse response = receiveResponse(childTimes);
+    {
+        std::lock_guard<std::mutex> lock(sentMutex);
+        sentRequests.pop_front();
+    }
+#ifdef IPC_ENABLE_PHASE_TIMING
+    phases.recordChild(childTimes, completions.submittedNs(response.requestId));
+#endif
+    completions.complete(response.requestId, completions.buffer(response.requestId));
+}
+
+void IPCCrossMemory::exitSubprocess() {
+    completions.drain();
+    CrossMemoryRequest request = {};
+    request.command = CMA_EXIT;
+    writeMessage(requestPipe[1], &request, sizeof(request));
+    close(requestPipe[1]);
+    requestPipe[1] = -1;
+    waitpid(childPid, nullptr, 0);
+    childPid = -1;
+    revokeChildAccess();
+}
@@ -0,0 +1,62 @@
+#include "IPCFactory.h"
+#include "IPCCrossMemory.h"
+#include "IPCPipe.h"
+#include "IPCSharedMemory.h"
+#include "IPCSharedMemoryRing.h"
+#include "IPCSharedMemoryArena.h"
+#include "IPCSocket.h"
+#include "IPCUnixSocket.h"
+#include <functional>
+#include <utility>
+
+namespace {
+
+using Factory = std::function<std::unique_ptr<IPCMethod>()>;
+
+// every transport configuration the benchmark knows about, keyed by its methodName()
+const std::vector<std::pair<std::string, Factory>>& registry() {
+    static const std::vector<std::pair<std::string, Factory>> methods = {
+        {"Pipe",                   [] { return std::make_unique<IPCPipe>(); }},
+        {"PipeSplice",             [] { return std::make_unique<IPCPipe>(true, 1024 * 1024); }},
+        {"PipeIoUring",            [] { return std::make_unique<IPCPipe>(false, 0, IO_URING_ON); }},
+        {"PipeIoUringSqpoll",      [] { return std::make_unique<IPCPipe>(false, 0, IO_URING_SQPOLL); }},
+        {"PipeStream",             [] { return std::make_unique<IPCPipe>(false, 0, IO_URING_OFF, true); }},
+        {"SharedMemory",           [] { return std::make_unique<IPCSharedMemory>(); }},
+        {"SharedMemoryPersistent", [] { return std::make_unique<IPCSharedMemory>(true); }},
+        {"SharedMemoryHugePages",  [] { return std::make_unique<IPCSharedMemory>(true, true); }},
+        {"SharedMemoryBusyPoll",   [] { return std::make_unique<IPCSharedMemory>(true, false, WAIT_BUSY_POLL); }},
+        {"SharedMemorySpinFutex",  [] { return std::make_unique<IPCSharedMemory>(true, false, WAIT_SPIN_FUTEX); }},
+        {"SharedMemoryEventfd",    [] { return std::make_unique<IPCSharedMemory>(true, false, WAIT_EVENTFD); }},
+        {"SharedMemoryEventfdEpoll", [] { return std::make_unique<IPCSharedMemory>(true, false, WAIT_EVENTFD_EPOLL); }},
+        {"SharedMemoryRing",       [] { return std::make_unique<IPCSharedMemoryRing>(); }},
+        {"SharedMemoryArena",      [] { return std::make_unique<IPCSharedMemoryArena>(); }},
+        {"CrossMemory",            [] { return std::make_unique<IPCCrossMemory>(); }},
+        {"Socket",                 [] { return std::make_unique<IPCSocket>(); }},
+        {"SocketZeroCopy",         [] { return std::make_unique<IPCSocket>(true); }},
+        {"SocketIoUring",          [] { return std::make_unique<IPCSocket>(false, 0, IO_URING_ON); }},
+        {"SocketIoUringSqpoll",    [] { return std::make_unique<IPCSocket>(false, 0, IO_URING_SQPOLL); }},
+        {"SocketStream",           [] { return std::make_unique<IPCSocket>(false, 0, IO_URING_OFF, true); }},
+        {"UnixStream",             [] { return std::make_unique<IPCUnixSocket>(SOCK_STREAM); }},
+        {"UnixSeqpacket",          [] { return std::make_unique<IPCUnixSocket>(SOCK_SEQPACKET); }},
+    };
+    return methods;
+}
+
+} // namespace
+
+std::vector<std::string> availableIPCMethods() {
+    std::vector<std::string> names;
+    for (const auto& entry : registry()) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+std::unique_ptr<IPCMethod> createIPCMethod(const std::string& name) {
+    for (const auto& entry : registry()) {
+        if (entry.first == name) {
+            return entry.second();
+        }
+    }
+    return nullptr;
+}
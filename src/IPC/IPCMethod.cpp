@@ -0,0 +1,35 @@
+#include "IPCMethod.h"
+#include "MatrixOperation.h"
+#include <atomic>
+#include <iostream>
+#include <unistd.h>
+
+std::string IPCMethod::uniqueChannelName(const std::string& prefix) {
+    static std::atomic<unsigned> counter{0};
+    return prefix + "_" + std::to_string(getpid()) + "_" + std::to_string(counter++);
+}
+
+torch::Tensor IPCMethod::encodeRequest(const torch::Tensor& matrix, TensorWireHeader& header) const {
+    torch::Tensor payload = encodeForWire(matrix, sparseThreshold(), header);
+    header.op = matrixOp;
+    return payload;
+}
+
+void IPCMethod::serveWorker(const ChannelArguments& args) {
+    std::cerr << methodName() << " can't be served by a spawned worker" << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+void IPCMethod::sendAndReceive(int matrixSize) {
+    initSubprocess();
+    torch::Tensor matrix = allocateMatrix(matrixSize, matrixSize);
+    MatrixOperation::fillRandomMatrix(matrix);
+    torch::Tensor result = sendAndReceiveV2(matrix);
+    const MatrixOpInfo& op = MatrixOperation::operation(operation());
+    if (op.verify(matrix, result)) {
+        std::cout << methodName() << ": The matrix was processed correctly (" << op.name << ")." << std::endl;
+    } else {
+        std::cout << methodName() << ": The matrix was not processed correctly (" << op.name << ")." << std::endl;
+    }
+    exitSubprocess();
+}
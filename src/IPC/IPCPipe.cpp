@@ -6,16 +6,64 @@
 #include <vector>
 #include <cstring> // For memcpy
 #include <algorithm> 
+#include <deque>
+#include <errno.h>
 #include <fcntl.h>
+#include <sys/uio.h> // for vmsplice
 
 
-IPCPipe::IPCPipe() {
+IPCPipe::IPCPipe(bool useSplice, int pipeCapacity, IoUringMode ioUring, bool streaming)
+    : useSplice(useSplice && !streaming), streaming(streaming),
+      ioUringMode(useSplice || streaming ? IO_URING_OFF : ioUring) {
     // create two pipes
     if (pipe(dataPipe[0]) == -1 || pipe(dataPipe[1]) == -1 || pipe(controlPipe) == -1) {
         perror("pipe");
         exit(EXIT_FAILURE);
     }
-    
+    if (pipeCapacity > 0) {
+        setPipeCapacity(dataPipe[0][1], pipeCapacity);
+        setPipeCapacity(dataPipe[1][1], pipeCapacity);
+    }
+}
+
+// grow a pipe so a large matrix needs fewer wake-ups; the kernel caps unprivileged
+// processes at /proc/sys/fs/pipe-max-size, so failure is not fatal
+void IPCPipe::setPipeCapacity(int fd, int capacity) {
+#ifdef F_SETPIPE_SZ
+    int actual = fcntl(fd, F_SETPIPE_SZ, capacity);
+    if (actual == -1) {
+        perror("fcntl(F_SETPIPE_SZ)");
+        return;
+    }
+    DEBUG_PRINT(1, "Pipes: Pipe capacity set to " << actual << " bytes\n");
+#endif
+}
+
+std::string IPCPipe::methodName() const {
+    if (useSplice) {
+        return "PipeSplice";
+    }
+    if (streaming) {
+        return "PipeStream";
+    }
+    switch (ioUringMode) {
+    case IO_URING_ON:     return "PipeIoUring";
+    case IO_URING_SQPOLL: return "PipeIoUringSqpoll";
+    default:              return "Pipe";
+    }
+}
+
+// rings are per process (and per thread), so each side sets up its own after the fork. a
+// side without io_uring keeps using read/write; the frames are the same either way.
+void IPCPipe::setupIoUring(const std::vector<int>& sendFds, const std::vector<int>& receiveFds) {
+    if (ioUringMode == IO_URING_OFF) {
+        return;
+    }
+    if (!sendRing.init(ioUringMode, sendFds) || !receiveRing.init(ioUringMode, receiveFds)) {
+        sendRing.close();
+        receiveRing.close();
+        DEBUG_PRINT(1, "Pipes: io_uring unavailable, using read/write\n");
+    }
 }
 
 IPCPipe::~IPCPipe() {
@@ -27,159 +75,499 @@ IPCPipe::~IPCPipe() {
 
 
 void IPCPipe::initSubprocess() {
+    if (spawnsWorker()) {
+        // the worker gets the child's ends; the parent's ends stay out of it
+        closeOnExec(controlPipe[1]);
+        closeOnExec(dataPipe[0][1]);
+        closeOnExec(dataPipe[1][0]);
+        childPid = spawnWorker(methodName(), {{"control", std::to_string(controlPipe[0])},
+                                              {"request", std::to_string(dataPipe[0][0])},
+                                              {"result", std::to_string(dataPipe[1][1])}});
+        setupIoUring({controlPipe[1], dataPipe[0][1]}, {dataPipe[1][0]});
+        return;
+    }
     childPid = fork();
     if (childPid == -1) {
         perror("fork");
         exit(EXIT_FAILURE);
     } else if (childPid == 0) { // child process
         // close(controlPipe[1]); // close unused write end of control pipe
-        torch::Tensor matrix, result;
-        char cmd[10];
-        while (true) {
-            ssize_t bytesRead = read(controlPipe[0], cmd, sizeof(cmd));
-            if (bytesRead > 0) {
-                cmd[bytesRead] = '\0';
-                if (strncmp(cmd, "Process", 7) == 0) {
-                    DEBUG_PRINT(2, "Pipes: Child entered processing\n");
-
-                    // read matrix from the pipe
-                    readMatrixFromPipe(dataPipe[0][0], matrix, matrixSize);
-                    DEBUG_PRINT(1, "Pipes: Child read matrix from the pipe\n");
-                    // MatrixOperation::printMatrix(matrix);
-
-                    // process the matrix
-                    result = MatrixOperation::squareMatrix(matrix);
-
-                    // write the processed matrix back to the pipe
-                    writeMatrixToPipe(dataPipe[1][1], result);
-                    DEBUG_PRINT(1, "Pipes: Child wrote matrix to the pipe\n");
-                    // MatrixOperation::printMatrix(result);
-
-                    
-                    // after processing, send "Wait" command to itself to be in wait state
-                    writeToControlPipe("Wait");
-                } else if (strncmp(cmd, "Exit", 4) == 0) {
-                    break; // exit the loop and clean up
-                }
-        
-            }
-            
-        }
+        setupIoUring({dataPipe[1][1]}, {controlPipe[0], dataPipe[0][0]});
+        serveRequests();
         exit(0);
     } else { // Parent process
-        
+        setupIoUring({controlPipe[1], dataPipe[0][1]}, {dataPipe[1][0]});
     }
 }
 
-void IPCPipe::writeToControlPipe(const char* msg, int matrixSize) {
-    // send a "Size" message if matrixSize is provided
-    if (matrixSize >= 0) {
-        const char* sizeMsg = "Size";
-        write(controlPipe[1], sizeMsg, strlen(sizeMsg) + 1);    // send "Size" indicator
-        write(controlPipe[1], &matrixSize, sizeof(matrixSize)); // send the actual matrixSize
+// worker: the pipes the constructor made go, the inherited ones are served in their place
+void IPCPipe::serveWorker(const ChannelArguments& args) {
+    close(dataPipe[0][0]); close(dataPipe[0][1]);
+    close(dataPipe[1][0]); close(dataPipe[1][1]);
+    close(controlPipe[0]); close(controlPipe[1]);
+    controlPipe[0] = channelNumber(args, "control");
+    dataPipe[0][0] = channelNumber(args, "request");
+    dataPipe[1][1] = channelNumber(args, "result");
+    controlPipe[1] = dataPipe[0][1] = dataPipe[1][0] = -1;
+    setupIoUring({dataPipe[1][1]}, {controlPipe[0], dataPipe[0][0]});
+    serveRequests();
+}
+
+void IPCPipe::serveRequests() {
+    torch::Tensor matrix, result;
+    TensorWireHeader header;
+    PipeControlMessage message;
+    // spliced results are referenced by the pipe until the parent reads them, which with
+    // several requests in flight can be after the child moved on. a result is released
+    // once a pipe capacity worth of bytes was written behind it.
+    std::deque<std::pair<torch::Tensor, uint64_t>> splicedResults; // result, end offset
+    uint64_t bytesWritten = 0;
+    uint64_t resultPipeBytes = 65536;
+#ifdef F_GETPIPE_SZ
+    int capacity = fcntl(dataPipe[1][1], F_GETPIPE_SZ);
+    if (capacity > 0) {
+        resultPipeBytes = capacity;
     }
-    // send the command message
-    else if (write(controlPipe[1], msg, strlen(msg) + 1) == -1) {
+#endif
+    // requests are served strictly in order; the parent may already have queued more
+    while (readFromControlPipe(message) && message.command != PIPE_EXIT) {
+        if (message.command != PIPE_PROCESS) {
+            continue;
+        }
+        DEBUG_PRINT(2, "Pipes: Child entered processing\n");
+        IPC_PHASE_TIMES(childTimes);
+        IPC_PHASE_MARK_WAKE(childTimes);
+
+        if (streaming) {
+            // read, compute and write overlap, so all of it counts as compute
+            IPC_PHASE_START(streamStart);
+            streamApply(message.requestId);
+            IPC_PHASE_ADD(childTimes, PHASE_COMPUTE, streamStart);
+#ifdef IPC_ENABLE_PHASE_TIMING
+            write(dataPipe[1][1], &childTimes, sizeof(childTimes));
+#endif
+            continue;
+        }
+
+        // read matrix from the pipe
+        IPC_PHASE_START(readStart);
+        if (receiveRing.available()) {
+            // into the registered buffer; matrix refers to it until the next request
+            header = readMatrixIoUring(dataPipe[0][0], matrix, true);
+        } else {
+            header = readMatrixFromPipe(dataPipe[0][0], matrix);
+        }
+        IPC_PHASE_ADD(childTimes, PHASE_CHILD_READ, readStart);
+        DEBUG_PRINT(1, "Pipes: Child read matrix from the pipe\n");
+        // MatrixOperation::printMatrix(matrix);
+
+        // process the matrix
+        IPC_PHASE_START(computeStart);
+        // elementwise ops answer a sparse request sparse, under the same indices; header
+        // describes the result from here on
+        result = MatrixOperation::applyPayload(matrix, header);
+        IPC_PHASE_ADD(childTimes, PHASE_COMPUTE, computeStart);
+
+        // write the request id and the processed matrix back to the pipe. the child never
+        // writes to result again, so its pages can be gifted
+        IPC_PHASE_START(writeStart);
+        if (sendRing.available()) {
+            sendRing.queueWrite(dataPipe[1][1], &message.requestId, sizeof(message.requestId));
+            writeMatrixIoUring(dataPipe[1][1], result, header);
+        } else {
+            if (write(dataPipe[1][1], &message.requestId, sizeof(message.requestId)) == -1) {
+                perror("write");
+                exit(EXIT_FAILURE);
+            }
+            if (useSplice) {
+                spliceMatrixToPipe(dataPipe[1][1], result, header, true);
+            } else {
+                writeMatrixToPipe(dataPipe[1][1], result, header);
+            }
+        }
+        IPC_PHASE_ADD(childTimes, PHASE_CHILD_WRITE, writeStart);
+        DEBUG_PRINT(1, "Pipes: Child wrote matrix to the pipe\n");
+        // MatrixOperation::printMatrix(result);
+#ifdef IPC_ENABLE_PHASE_TIMING
+        // ship the child's phase times back behind the result
+        if (sendRing.available()) {
+            sendRing.writeFull(dataPipe[1][1], &childTimes, sizeof(childTimes));
+        } else {
+            write(dataPipe[1][1], &childTimes, sizeof(childTimes));
+        }
+        bytesWritten += sizeof(childTimes);
+#endif
+
+        bytesWritten += sizeof(message.requestId) + sizeof(TensorWireHeader) + wirePayloadBytes(header);
+        if (useSplice) {
+            splicedResults.emplace_back(result, bytesWritten);
+            while (bytesWritten - splicedResults.front().second >= resultPipeBytes) {
+                splicedResults.pop_front();
+            }
+        }
+    }
+}
+
+void IPCPipe::writeToControlPipe(PipeCommand command, uint64_t requestId) {
+    PipeControlMessage message;
+    message.command = command;
+    message.reserved = 0;
+    message.requestId = requestId;
+    if (write(controlPipe[1], &message, sizeof(message)) != sizeof(message)) {
         perror("write");
         exit(EXIT_FAILURE);
     }
-    DEBUG_PRINT(1, "Pipes: Parent wrote to control pipe: " << msg << std::endl);
+    DEBUG_PRINT(1, "Pipes: Parent wrote to control pipe: " << command << " " << requestId << std::endl);
+}
+
+// returns false once the parent has gone away
+bool IPCPipe::readFromControlPipe(PipeControlMessage& message) {
+    if (receiveRing.available()) {
+        ssize_t bytesRead = receiveRing.readFull(controlPipe[0], &message, sizeof(message));
+        if (bytesRead == -1) {
+            perror("io_uring read");
+        }
+        return bytesRead == sizeof(message);
+    }
+    while (true) {
+        ssize_t bytesRead = read(controlPipe[0], &message, sizeof(message));
+        if (bytesRead == sizeof(message)) {
+            return true;
+        }
+        if (bytesRead == -1 && errno == EINTR) {
+            continue;
+        }
+        if (bytesRead == -1) {
+            perror("read");
+        }
+        return false;
+    }
 }
 
+// signal the child and write the payload to the first pipe. with vmsplice the pipe refers to
+// the payload pages until the child has read them, so the caller keeps payload untouched
+// until its result is back
+void IPCPipe::sendRequest(const torch::Tensor& payload, const TensorWireHeader& header, uint64_t requestId) {
+    if (sendRing.available()) {
+        // control message, size and matrix go out in a single submission
+        PipeControlMessage message;
+        message.command = PIPE_PROCESS;
+        message.reserved = 0;
+        message.requestId = requestId;
+        sendRing.queueWrite(controlPipe[1], &message, sizeof(message));
+        writeMatrixIoUring(dataPipe[0][1], payload, header);
+        DEBUG_PRINT(1, "Pipes: Parent submitted request " << requestId << " through io_uring\n");
+        return;
+    }
+    writeToControlPipe(PIPE_PROCESS, requestId);
+    if (useSplice) {
+        spliceMatrixToPipe(dataPipe[0][1], payload, header, false);
+    } else {
+        writeMatrixToPipe(dataPipe[0][1], payload, header);
+    }
+    DEBUG_PRINT(1, "Pipes: Parent wrote matrix to the pipe\n");
+}
 
-std::string IPCPipe::readFromControlPipe() {
-    char buffer[256];
-    ssize_t bytesRead = read(controlPipe[0], buffer, sizeof(buffer));
-    if (bytesRead == -1) {
-        perror("read");
+// read the next result, and the child's phase times behind it, from the second pipe;
+// returns the id of the request it answers
+uint64_t IPCPipe::receiveResult(torch::Tensor& result, PhaseTimes& childTimes) {
+    uint64_t requestId;
+    TensorWireHeader header;
+    if (receiveRing.available()) {
+        // request id and size in one submission, the matrix in the next
+        receiveRing.queueRead(dataPipe[1][0], &requestId, sizeof(requestId));
+        header = readMatrixIoUring(dataPipe[1][0], result, false);
+#ifdef IPC_ENABLE_PHASE_TIMING
+        if (receiveRing.readFull(dataPipe[1][0], &childTimes, sizeof(childTimes)) != sizeof(childTimes)) {
+            childTimes.clear();
+        }
+#endif
+        result = decodeFromWire(result, header);
+        return requestId;
+    }
+    if (read(dataPipe[1][0], &requestId, sizeof(requestId)) != sizeof(requestId)) {
+        std::cerr << "Error: Did not read the request id from the pipe." << std::endl;
         exit(EXIT_FAILURE);
     }
-    return std::string(buffer);
-}
+    header = readMatrixFromPipe(dataPipe[1][0], result);
+    DEBUG_PRINT(1, "Pipes: Parent read matrix from the pipe\n");
+    // MatrixOperation::printMatrix(result);
 
-// set matrix size
-void IPCPipe::setMatrixSize(int matrixSize) {
-    // not using this in v2 anymore
-    // signal child process to set matrix size
-    // writeToControlPipe("Size", matrixSize);
-    this->matrixSize = matrixSize;
+#ifdef IPC_ENABLE_PHASE_TIMING
+    if (read(dataPipe[1][0], &childTimes, sizeof(childTimes)) != sizeof(childTimes)) {
+        childTimes.clear();
+    }
+#endif
+    result = decodeFromWire(result, header);
+    return requestId;
 }
 
 torch::Tensor IPCPipe::sendAndReceiveV2(const torch::Tensor& matrix) {
+    if (streaming) {
+        // results start coming back while the request is still being written, so something
+        // has to read them meanwhile or both pipes fill up: the completion thread
+        return submit(matrix).get();
+    }
+    completions.drain(); // the synchronous path reads the result pipe itself
     torch::Tensor result;
-
-    // signal child process to start processing
-    writeToControlPipe("Process");
-
-    // write the matrix to the first pipe
-    writeMatrixToPipe(dataPipe[0][1], matrix);
-    DEBUG_PRINT(1, "Pipes: Parent wrote matrix to the pipe\n");
+    PhaseTimes childTimes;
+    IPC_PHASE_TIMES(parentTimes);
+    IPC_PHASE_START(requestStart);
+
+    // the payload is not modified before the child has consumed it because we block on the
+    // result below
+    TensorWireHeader header;
+    torch::Tensor payload = encodeRequest(matrix, header);
+    sendRequest(payload, header, 0);
+    IPC_PHASE_ADD(parentTimes, PHASE_WRITE, requestStart);
     // MatrixOperation::printMatrix(matrix);
 
-    // read the processed matrix from the second pipe
-    readMatrixFromPipe(dataPipe[1][0], result, matrixSize);
-    DEBUG_PRINT(1, "Pipes: Parent read matrix from the pipe\n");
-    // MatrixOperation::printMatrix(result);
+    IPC_PHASE_START(readStart);
+    receiveResult(result, childTimes);
+    IPC_PHASE_ADD(parentTimes, PHASE_READ, readStart);
 
+    IPC_PHASE_COMMIT(phases, parentTimes);
+#ifdef IPC_ENABLE_PHASE_TIMING
+    phases.recordChild(childTimes, requestStart);
+#endif
     return result;
 }
 
+std::future<torch::Tensor> IPCPipe::submit(const torch::Tensor& matrix) {
+    TensorWireHeader header;
+    torch::Tensor payload = encodeRequest(matrix, header);
+    std::future<torch::Tensor> future;
+    // payload stays pinned until its result is back, the pipe may still refer to its pages
+    uint64_t requestId = completions.begin(future, payload, maxInFlight(), [this] { completeOneRequest(); });
+    sendRequest(payload, header, requestId);
+    return future;
+}
+
+// completion thread: results come back in the order the child serves them
+void IPCPipe::completeOneRequest() {
+    torch::Tensor result;
+    PhaseTimes childTimes;
+    uint64_t requestId = receiveResult(result, childTimes);
+#ifdef IPC_ENABLE_PHASE_TIMING
+    phases.recordChild(childTimes, completions.submittedNs(requestId));
+#endif
+    completions.complete(requestId, result);
+}
+
 void IPCPipe::exitSubprocess() {
-    writeToControlPipe("Exit");
+    completions.drain();
+    writeToControlPipe(PIPE_EXIT);
+    // the rings hold references to the pipes until they are torn down
+    sendRing.close();
+    receiveRing.close();
     close(controlPipe[1]);
     waitpid(childPid, nullptr, 0);
 }
 
 
-void IPCPipe::writeMatrixToPipe(int fd, const torch::Tensor &matrix) {
-
-    auto data = matrix.data_ptr<CPP_TENSOR_DTYPE>();
-    auto totalBytes = matrix.numel() * sizeof(CPP_TENSOR_DTYPE);
-    int matrixSize = matrix.size(0); // assuming square matrix
-    write(fd, &matrixSize, sizeof(matrixSize));
-    auto bytesWritten = 0;
-    while (bytesWritten < totalBytes) {
-        size_t elementsToWrite = std::min(static_cast<size_t>(PIPE_BUF / sizeof(CPP_TENSOR_DTYPE)),
-                                           static_cast<size_t>(totalBytes - bytesWritten) / sizeof(CPP_TENSOR_DTYPE));
-        size_t written = write(fd, data + (bytesWritten / sizeof(CPP_TENSOR_DTYPE)), elementsToWrite * sizeof(CPP_TENSOR_DTYPE));
+// chunks of whole elements that fit in PIPE_BUF, so every write is atomic
+template <typename T>
+static void writeElements(int fd, const T* data, size_t count) {
+    const size_t chunkElements = std::max<size_t>(1, PIPE_BUF / sizeof(T));
+    size_t elementsWritten = 0;
+    while (elementsWritten < count) {
+        size_t elementsToWrite = std::min(chunkElements, count - elementsWritten);
+        ssize_t written = write(fd, data + elementsWritten, elementsToWrite * sizeof(T));
         if (written == -1) {
             perror("write");
             exit(EXIT_FAILURE);
         }
-        bytesWritten += written;
+        elementsWritten += written / sizeof(T);
     }
 }
 
-void IPCPipe::readMatrixFromPipe(int fd, torch::Tensor &matrix, int matrixSizes) {
-    //print matrix size
-    int matrixSize;
-    read(fd, &matrixSize, sizeof(matrixSize));
-    const auto totalSize = matrixSize * matrixSize * sizeof(CPP_TENSOR_DTYPE);
-    std::vector<CPP_TENSOR_DTYPE> buffer(matrixSize * matrixSize);
+template <typename T>
+static bool readElements(int fd, T* data, size_t count) {
+    const size_t totalSize = count * sizeof(T);
+    char* bytes = reinterpret_cast<char*>(data);
     size_t bytesReadTotal = 0;
 
     // continue reading until all data has been received
     while (bytesReadTotal < totalSize) {
-        auto remaining = totalSize - bytesReadTotal;
-        ssize_t bytesRead = read(fd, &buffer.data()[bytesReadTotal / sizeof(CPP_TENSOR_DTYPE)], remaining);
+        ssize_t bytesRead = read(fd, bytes + bytesReadTotal, totalSize - bytesReadTotal);
         if (bytesRead < 0) {
+            if (errno == EINTR) continue;
             perror("read");
             exit(EXIT_FAILURE);
         } else if (bytesRead == 0) {
-            // end of file reached or pipe closed, might need special handling
-            break; // may indicate that the writing side has closed the pipe, so break
-        } else {
-            bytesReadTotal += bytesRead;
+            break; // writing side closed the pipe
         }
+        bytesReadTotal += bytesRead;
     }
+    return bytesReadTotal == totalSize;
+}
 
-    // ensure the entire matrix data was read
-    if (bytesReadTotal != totalSize) {
+// the header is smaller than PIPE_BUF and written in one go, so it arrives whole
+static TensorWireHeader readWireHeader(int fd) {
+    TensorWireHeader header;
+    if (read(fd, &header, sizeof(header)) != sizeof(header) || !validWireHeader(header)) {
+        std::cerr << "Error: Did not read a valid tensor header from the pipe." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return header;
+}
+
+static void writeWireHeader(int fd, const TensorWireHeader& header) {
+    if (write(fd, &header, sizeof(header)) != sizeof(header)) {
+        perror("write");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void IPCPipe::writeMatrixToPipe(int fd, const torch::Tensor &payload, const TensorWireHeader& header) {
+    writeWireHeader(fd, header);
+    if (wireSparse(header)) {
+        writeElements(fd, static_cast<const char*>(payload.data_ptr()), wirePayloadBytes(header));
+        return;
+    }
+    visitWireDtype(header.dtype, [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        writeElements(fd, static_cast<const T*>(payload.data_ptr()), payload.numel());
+    });
+}
+
+// straight into a pooled tensor, dense or sparse; the writer's PIPE_BUF sized chunks don't
+// matter to the reader
+TensorWireHeader IPCPipe::readMatrixFromPipe(int fd, torch::Tensor &matrix) {
+    TensorWireHeader header = readWireHeader(fd);
+    matrix = emptyFromWire(header);
+    if (!readElements(fd, static_cast<char*>(matrix.data_ptr()), wirePayloadBytes(header))) {
         std::cerr << "Error: Did not read the entire matrix from the pipe." << std::endl;
         exit(EXIT_FAILURE);
     }
+    return header;
+}
 
-    matrix = torch::from_blob(buffer.data(), {matrixSize, matrixSize}).clone();
+// whole chunks at a time; with one writer per pipe the chunks needn't be atomic
+static void writeBytes(int fd, const char* data, size_t count) {
+    size_t bytesWritten = 0;
+    while (bytesWritten < count) {
+        ssize_t written = write(fd, data + bytesWritten, count - bytesWritten);
+        if (written == -1) {
+            if (errno == EINTR) continue;
+            perror("write");
+            exit(EXIT_FAILURE);
+        }
+        bytesWritten += written;
+    }
+}
+
+// the result frame goes out as soon as the request header is in; an elementwise op keeps the
+// layout, so the header is the same. then each chunk is processed and written back while the
+// parent is still sending the next ones, with one chunk buffered here and the pipes' worth in flight
+void IPCPipe::streamApply(uint64_t requestId) {
+    TensorWireHeader header = readWireHeader(dataPipe[0][0]);
+    if (write(dataPipe[1][1], &requestId, sizeof(requestId)) != sizeof(requestId)) {
+        perror("write");
+        exit(EXIT_FAILURE);
+    }
+    writeWireHeader(dataPipe[1][1], header);
+
+    if (!streamChunk.defined() || streamChunk.numel() == 0) {
+        streamChunk = torch::empty({TENSOR_WIRE_STREAM_CHUNK}, torch::kUInt8);
+    }
+    char* chunk = static_cast<char*>(streamChunk.data_ptr());
+    const size_t totalBytes = wirePayloadBytes(header);
+    for (size_t offset = 0; offset < totalBytes;) {
+        size_t chunkBytes = std::min<size_t>(TENSOR_WIRE_STREAM_CHUNK, totalBytes - offset);
+        if (!readElements(dataPipe[0][0], chunk, chunkBytes)) {
+            std::cerr << "Error: Did not read the entire matrix from the pipe." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        MatrixOperation::applyPayloadChunk(chunk, offset, chunkBytes, header);
+        writeBytes(dataPipe[1][1], chunk, chunkBytes);
+        offset += chunkBytes;
+    }
+    DEBUG_PRINT(1, "Pipes: Child streamed " << totalBytes << " bytes back\n");
+}
+
+// map the tensor pages into the pipe instead of copying them through PIPE_BUF sized writes.
+// gift hands the pages over to the kernel; only valid when the caller won't touch them again
+// before they are read, and only used when they are page aligned
+void IPCPipe::spliceMatrixToPipe(int fd, const torch::Tensor &payload, const TensorWireHeader& header, bool gift) {
+    writeWireHeader(fd, header);
+
+    char* data = static_cast<char*>(payload.data_ptr());
+    size_t totalBytes = wirePayloadBytes(header);
+#ifdef SPLICE_F_GIFT
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    unsigned int flags = 0;
+    if (gift && reinterpret_cast<uintptr_t>(data) % pageSize == 0 && totalBytes % pageSize == 0) {
+        flags |= SPLICE_F_GIFT;
+    }
+    size_t bytesSpliced = 0;
+    while (bytesSpliced < totalBytes) {
+        struct iovec iov;
+        iov.iov_base = data + bytesSpliced;
+        iov.iov_len = totalBytes - bytesSpliced;
+        ssize_t spliced = vmsplice(fd, &iov, 1, flags);
+        if (spliced == -1) {
+            if (errno == EINTR) continue;
+            perror("vmsplice");
+            exit(EXIT_FAILURE);
+        }
+        bytesSpliced += spliced;
+    }
+#else
+    // no vmsplice on this platform: plain writes of whatever the pipe will take
+    size_t bytesWritten = 0;
+    while (bytesWritten < totalBytes) {
+        ssize_t written = write(fd, data + bytesWritten, totalBytes - bytesWritten);
+        if (written == -1) {
+            if (errno == EINTR) continue;
+            perror("write");
+            exit(EXIT_FAILURE);
+        }
+        bytesWritten += written;
+    }
+#endif
+}
+
+// queue the header and the matrix behind whatever the caller queued, and submit all of it.
+// the matrix goes out in one write instead of PIPE_BUF sized ones; atomicity doesn't matter
+// with a single writer per pipe
+void IPCPipe::writeMatrixIoUring(int fd, const torch::Tensor &payload, const TensorWireHeader& header) {
+    sendRing.queueWrite(fd, &header, sizeof(header));
+    sendRing.queueWrite(fd, payload.data_ptr(), wirePayloadBytes(header));
+    if (sendRing.transferAll() == -1) {
+        perror("io_uring write");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// read the header (together with whatever the caller queued), then the matrix. staged reads
+// land in the ring's registered buffer and matrix only borrows it; otherwise matrix gets
+// its own storage
+TensorWireHeader IPCPipe::readMatrixIoUring(int fd, torch::Tensor &matrix, bool staged) {
+    TensorWireHeader header;
+    receiveRing.queueRead(fd, &header, sizeof(header));
+    if (receiveRing.transferAll() == -1) {
+        perror("io_uring read");
+        exit(EXIT_FAILURE);
+    }
+    if (!validWireHeader(header)) {
+        std::cerr << "Error: Did not read a valid tensor header from the pipe." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    const size_t totalSize = wirePayloadBytes(header);
+    void* data;
+    if (staged) {
+        data = receiveRing.stagingBuffer(totalSize);
+        matrix = tensorFromWire(data, header);
+    } else {
+        matrix = emptyFromWire(header);
+        data = matrix.data_ptr();
+    }
+    if (receiveRing.readFull(fd, data, totalSize) != static_cast<ssize_t>(totalSize)) {
+        std::cerr << "Error: Did not read the entire matrix from the pipe." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return header;
 }
 
 void IPCPipe::sendAndReceive(int matrixSize) {
@@ -203,7 +591,7 @@ void IPCPipe::sendAndReceive(int matrixSize) {
         close(pipefd[1][0]); // close unused read end of second pipe
 
         // read matrix from the pipe
-        readMatrixFromPipe(pipefd[0][0], matrix, matrixSize);
+        readMatrixFromPipe(pipefd[0][0], matrix);
         DEBUG_PRINT(1, "Pipes: Child read matrix from the pipe\n");
         // MatrixOperation::printMatrix(matrix);
 
@@ -211,7 +599,7 @@ void IPCPipe::sendAndReceive(int matrixSize) {
         result = MatrixOperation::squareMatrix(matrix);
 
         // write the processed matrix back to the pipe
-        writeMatrixToPipe(pipefd[1][1], result);
+        writeMatrixToPipe(pipefd[1][1], result, describeTensor(result));
         DEBUG_PRINT(1, "Pipes: Child wrote matrix to the pipe\n");
         // MatrixOperation::printMatrix(result);
 
@@ -226,12 +614,12 @@ void IPCPipe::sendAndReceive(int matrixSize) {
         matrix = MatrixOperation::generateRandomMatrix(matrixSize);
         
         // write the matrix to the first pipe
-        writeMatrixToPipe(pipefd[0][1], matrix);
+        writeMatrixToPipe(pipefd[0][1], matrix, describeTensor(matrix));
         DEBUG_PRINT(1, "Pipes: Parent wrote matrix to the pipe\n");
         // MatrixOperation::printMatrix(matrix);
 
         // read the processed matrix from the second pipe
-        readMatrixFromPipe(pipefd[1][0], result, matrixSize);
+        readMatrixFromPipe(pipefd[1][0], result);
         DEBUG_PRINT(1, "Pipes: Parent read matrix from the pipe\n");
         // MatrixOperation::printMatrix(result);
 
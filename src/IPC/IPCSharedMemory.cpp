@@ -1,4 +1,5 @@
 #include "IPCSharedMemory.h"
+#include "TensorWire.h"
 #include "MatrixOperation.h"
 #include <iostream>
 #include <errno.h> // include errno.h for errno
@@ -8,37 +9,92 @@
 #include <unistd.h>
 #include <cstring> // for memcpy
 #include <signal.h> // for kill
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+// size of the huge pages requested from hugetlbfs; used to round the mapping up
+static const off_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// with phase timing the child leaves its phase times at the end of the segment, so the
+// batches give up that much room
+#ifdef IPC_ENABLE_PHASE_TIMING
+static const int PHASE_TRAILER_BYTES = sizeof(PhaseTimes);
+#else
+static const int PHASE_TRAILER_BYTES = 0;
+#endif
+
+static off_t roundUp(off_t value, off_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// payload bytes per batch behind the header; a multiple of 8, so no element of any wire
+// dtype is split between two batches
+static size_t batchBytesFor(off_t shmSize) {
+    return (shmSize - sizeof(TensorWireHeader) - PHASE_TRAILER_BYTES) / 8 * 8;
+}
 
 // constructor
-IPCSharedMemory::IPCSharedMemory() {
+IPCSharedMemory::IPCSharedMemory(bool persistentMapping, bool hugePages, WaitStrategy waitStrategy)
+    : persistentMapping(persistentMapping || hugePages), hugePages(hugePages), waitStrategy(waitStrategy) {
+    // every channel gets its own segment and semaphores, so modes and worker pools can run
+    // side by side
+    shmName = uniqueChannelName("/dv_ipc_shared_mem");
+    semParentToChildName = uniqueChannelName("/sem_parent_to_child");
+    semChildToParentName = uniqueChannelName("/sem_child_to_parent");
+    semExitName = uniqueChannelName("/sem_exit");
+
     // unlink old and open new semaphores
-    sem_unlink("/sem_parent_to_child");
-    sem_unlink("/sem_child_to_parent");
-    sem_unlink("/sem_exit");
+    sem_unlink(semParentToChildName.c_str());
+    sem_unlink(semChildToParentName.c_str());
+    sem_unlink(semExitName.c_str());
 
-    sem_parent_to_child = sem_open("/sem_parent_to_child", O_CREAT, 0666, 0);
+    sem_parent_to_child = sem_open(semParentToChildName.c_str(), O_CREAT, 0666, 0);
     if (sem_parent_to_child == SEM_FAILED) {
         perror("Error opening semaphore for parent to child");
         exit(EXIT_FAILURE);
     }
     DEBUG_PRINT(1, "SharedMem: Parent to child semaphore opened\n");
 
-    sem_child_to_parent = sem_open("/sem_child_to_parent", O_CREAT, 0666, 0);
+    sem_child_to_parent = sem_open(semChildToParentName.c_str(), O_CREAT, 0666, 0);
     if (sem_child_to_parent == SEM_FAILED) {
         perror("Error opening semaphore for child to parent");
         exit(EXIT_FAILURE);
     }
     DEBUG_PRINT(1, "SharedMem: Child to parent semaphore opened\n");
 
-    sem_exit = sem_open("/sem_exit", O_CREAT, 0666, 0);
+    sem_exit = sem_open(semExitName.c_str(), O_CREAT, 0666, 0);
     if (sem_exit == SEM_FAILED) {
         perror("Error opening semaphore for exit");
         exit(EXIT_FAILURE);
     }
     DEBUG_PRINT(1, "SharedMem: Exit semaphore opened\n");
 
+    if (usesEventfd()) {
+        // created before fork, so parent and child share them for good
+        events[0].create(waitStrategy == WAIT_EVENTFD_EPOLL);
+        events[1].create(waitStrategy == WAIT_EVENTFD_EPOLL);
+        DEBUG_PRINT(1, "SharedMem: " << waitStrategyName(waitStrategy) << " signals set up\n");
+    } else if (waitStrategy != WAIT_SEMAPHORE) {
+        // mapped before fork, so parent and child share it for good
+        void* page = mmap(NULL, 2 * sizeof(SharedSignal), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (page == MAP_FAILED) {
+            perror("mmap");
+            exit(EXIT_FAILURE);
+        }
+        signals = static_cast<SharedSignal*>(page);
+        signals[0].init();
+        signals[1].init();
+        DEBUG_PRINT(1, "SharedMem: " << waitStrategyName(waitStrategy) << " signals set up\n");
+    }
+
+    if (hugePages) {
+        createHugePageSegment();
+        return;
+    }
+
     // create shared memory
-    shmFd = shm_open(shmName, O_CREAT | O_RDWR, 0666);
+    shmFd = shm_open(shmName.c_str(), O_CREAT | O_RDWR, 0666);
     if (shmFd == -1) {
         perror("shm_open");
         exit(EXIT_FAILURE);
@@ -54,32 +110,137 @@ IPCSharedMemory::IPCSharedMemory() {
     DEBUG_PRINT(1, "SharedMem: Shared memory truncated\n");
 }
 
+// try a hugetlbfs backed memfd first; when the kernel has no huge pages reserved fall back
+// to a regular segment (rounded to the huge page size) and ask for transparent huge pages
+void IPCSharedMemory::createHugePageSegment() {
+    mapSize = roundUp(shmSize, HUGE_PAGE_SIZE);
+#if defined(__linux__) && defined(MFD_HUGETLB)
+    shmFd = memfd_create("dv_ipc_shared_mem_huge", MFD_HUGETLB);
+    if (shmFd != -1 && ftruncate(shmFd, mapSize) == 0) {
+        usingHugetlb = true;
+        DEBUG_PRINT(1, "SharedMem: Huge page memfd created\n");
+        return;
+    }
+    perror("memfd_create(MFD_HUGETLB), falling back to transparent huge pages");
+    if (shmFd != -1) {
+        close(shmFd);
+    }
+#endif
+    usingHugetlb = false;
+    shmFd = shm_open(shmName.c_str(), O_CREAT | O_RDWR, 0666);
+    if (shmFd == -1) {
+        perror("shm_open");
+        exit(EXIT_FAILURE);
+    }
+    if (ftruncate(shmFd, mapSize) == -1) {
+        perror("ftruncate");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// map the segment once, pre-faulted and locked so requests never take a page fault on it
+void IPCSharedMemory::mapSegment() {
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;
+#endif
+    shmAddr = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, flags, shmFd, 0);
+    if (shmAddr == MAP_FAILED && usingHugetlb) {
+        // hugetlbfs has no free pages: retry on a regular segment
+        perror("mmap(MFD_HUGETLB), falling back to transparent huge pages");
+        close(shmFd);
+        usingHugetlb = false;
+        shmFd = shm_open(shmName.c_str(), O_CREAT | O_RDWR, 0666);
+        if (shmFd == -1 || ftruncate(shmFd, mapSize) == -1) {
+            perror("shm_open");
+            exit(EXIT_FAILURE);
+        }
+        shmAddr = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, flags, shmFd, 0);
+    }
+    if (shmAddr == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+#ifdef MADV_HUGEPAGE
+    if (hugePages && !usingHugetlb && madvise(shmAddr, mapSize, MADV_HUGEPAGE) == -1) {
+        perror("madvise(MADV_HUGEPAGE)");
+    }
+#endif
+    if (mlock(shmAddr, mapSize) == -1) {
+        perror("mlock"); // not fatal, RLIMIT_MEMLOCK may be too low; MAP_POPULATE already faulted it in
+    }
+    // touch every page so the mapping is resident even where MAP_POPULATE is unavailable
+    std::memset(shmAddr, 0, mapSize);
+    DEBUG_PRINT(1, "SharedMem: Persistent mapping of " << mapSize << " bytes set up\n");
+}
+
+std::string IPCSharedMemory::methodName() const {
+    if (hugePages) {
+        return "SharedMemoryHugePages";
+    }
+    if (waitStrategy == WAIT_BUSY_POLL) {
+        return "SharedMemoryBusyPoll";
+    }
+    if (waitStrategy == WAIT_SPIN_FUTEX) {
+        return "SharedMemorySpinFutex";
+    }
+    if (waitStrategy == WAIT_EVENTFD) {
+        return "SharedMemoryEventfd";
+    }
+    if (waitStrategy == WAIT_EVENTFD_EPOLL) {
+        return "SharedMemoryEventfdEpoll";
+    }
+    return persistentMapping ? "SharedMemoryPersistent" : "SharedMemory";
+}
+
 // destructor
 IPCSharedMemory::~IPCSharedMemory() {
     // Cleanup
     if (shmFd != -1) {
         close(shmFd);
-        shm_unlink(shmName);
+        shm_unlink(shmName.c_str());
+    }
+    // exitSubprocess may already have closed them
+    if (sem_parent_to_child != nullptr) sem_close(sem_parent_to_child);
+    if (sem_child_to_parent != nullptr) sem_close(sem_child_to_parent);
+    if (sem_exit != nullptr) sem_close(sem_exit);
+    sem_unlink(semParentToChildName.c_str());
+    sem_unlink(semChildToParentName.c_str());
+    sem_unlink(semExitName.c_str());
+    if (signals != nullptr) {
+        munmap(signals, 2 * sizeof(SharedSignal));
+        signals = nullptr;
+    }
+    events[0].close();
+    events[1].close();
+    if (epollFd != -1) {
+        close(epollFd);
     }
-    sem_close(sem_parent_to_child);
-    sem_close(sem_child_to_parent);
-    sem_unlink("/sem_parent_to_child");
-    sem_unlink("/sem_child_to_parent");
     DEBUG_PRINT(1, "SharedMem: Cleaned up shared memory and semaphores in ~IPCSharedMemory\n");
 }
 
 void IPCSharedMemory::initSubprocess() {
+    if (persistentMapping && shmAddr == nullptr) {
+        mapSegment(); // before fork, so the child inherits the populated mapping
+    }
     childPid = fork();
     if (childPid == -1) {
         perror("fork");
         exit(EXIT_FAILURE);
     } else if (childPid == 0) { // Child
-        DEBUG_PRINT(1, "SharedMem: Child process created. Doing mmap\n");
-        DEBUG_PRINT(2, "SharedMem: Child - shmFd: " << shmFd<<std::endl);
-        shmAddr = mmap(NULL, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
-        if (shmAddr == MAP_FAILED) {
-            perror("mmap");
-            exit(EXIT_FAILURE);
+        if (waitStrategy == WAIT_EVENTFD_EPOLL) {
+            setupEpoll(0);
+        }
+        if (persistentMapping) {
+            mlock(shmAddr, mapSize); // locks are not inherited across fork
+        } else {
+            DEBUG_PRINT(1, "SharedMem: Child process created. Doing mmap\n");
+            DEBUG_PRINT(2, "SharedMem: Child - shmFd: " << shmFd<<std::endl);
+            shmAddr = mmap(NULL, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+            if (shmAddr == MAP_FAILED) {
+                perror("mmap");
+                exit(EXIT_FAILURE);
+            }
         }
         DEBUG_PRINT(1, "SharedMem: Child process mapped shared memory\n");
         
@@ -89,10 +250,35 @@ void IPCSharedMemory::initSubprocess() {
         }
 
         // Cleanup
-        munmap(shmAddr, shmSize);
+        munmap(shmAddr, mapSize);
         exit(0);
     }
     // Parent continues without waiting here
+    if (waitStrategy == WAIT_EVENTFD_EPOLL) {
+        setupEpoll(1);
+    }
+}
+
+// an epoll set of this process' own: one inherited from the parent would be shared with it.
+// a real event loop would add its sockets and timers next to the eventfd.
+void IPCSharedMemory::setupEpoll(int direction) {
+#ifdef __linux__
+    if (epollFd != -1) {
+        close(epollFd);
+    }
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd == -1) {
+        perror("epoll_create1");
+        exit(EXIT_FAILURE);
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = events[direction].fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, events[direction].fd, &event) == -1) {
+        perror("epoll_ctl");
+        exit(EXIT_FAILURE);
+    }
+#endif
 }
 
 torch::Tensor IPCSharedMemory::sendAndReceiveV2(const torch::Tensor& matrix) {
@@ -100,10 +286,12 @@ torch::Tensor IPCSharedMemory::sendAndReceiveV2(const torch::Tensor& matrix) {
     DEBUG_PRINT(1, "SharedMem: Parent process sending matrix to child process\n");
 
 
-    shmAddr = mmap(NULL, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
-    if (shmAddr == MAP_FAILED) {
-        perror("mmap");
-        exit(EXIT_FAILURE);
+    if (!persistentMapping) {
+        shmAddr = mmap(NULL, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+        if (shmAddr == MAP_FAILED) {
+            perror("mmap");
+            exit(EXIT_FAILURE);
+        }
     }
 
     DEBUG_PRINT(1, "SharedMem: Parent process has generated the matrix\n");
@@ -112,92 +300,176 @@ torch::Tensor IPCSharedMemory::sendAndReceiveV2(const torch::Tensor& matrix) {
     DEBUG_PRINT(1, "SharedMem: Parent process received squared matrix\n");
     // MatrixOperation::printMatrix(result);
 
-    munmap(shmAddr, shmSize);
+    if (!persistentMapping) {
+        munmap(shmAddr, shmSize);
+        shmAddr = nullptr;
+    }
     return result;
 }
 
 
+// handshake primitives; direction 0 is parent -> child, 1 is child -> parent
+void IPCSharedMemory::signalChild() {
+    if (waitStrategy == WAIT_SEMAPHORE) {
+        sem_post(sem_parent_to_child);
+    } else {
+        postTo(0);
+    }
+}
+
+void IPCSharedMemory::signalParent() {
+    if (waitStrategy == WAIT_SEMAPHORE) {
+        sem_post(sem_child_to_parent);
+    } else {
+        postTo(1);
+    }
+}
+
+void IPCSharedMemory::waitForParent() {
+    if (waitStrategy == WAIT_SEMAPHORE) {
+        sem_wait(sem_parent_to_child);
+    } else {
+        waitOn(0);
+    }
+}
+
+void IPCSharedMemory::waitForChild() {
+    if (waitStrategy == WAIT_SEMAPHORE) {
+        sem_wait(sem_child_to_parent);
+    } else {
+        waitOn(1);
+    }
+}
+
+void IPCSharedMemory::postTo(int direction) {
+    if (usesEventfd()) {
+        events[direction].post();
+    } else {
+        signals[direction].post();
+    }
+}
+
+void IPCSharedMemory::waitOn(int direction) {
+    switch (waitStrategy) {
+    case WAIT_BUSY_POLL:
+        signals[direction].busyWait();
+        break;
+    case WAIT_SPIN_FUTEX:
+        signals[direction].spinThenFutexWait(spinBudget);
+        break;
+    case WAIT_EVENTFD:
+        events[direction].wait();
+        break;
+    case WAIT_EVENTFD_EPOLL:
+        events[direction].waitWithEpoll(epollFd);
+        break;
+    case WAIT_SEMAPHORE:
+        break;
+    }
+}
+
 // write matrix in batches
 torch::Tensor IPCSharedMemory::writeMatrixInBatchesAndReadBack(const torch::Tensor& matrix) {
-    int totalElements = matrix.numel();
-    // write totalElements at the beginning of shared memory
-    std::memcpy(shmAddr, &totalElements, sizeof(int));
+    IPC_PHASE_TIMES(parentTimes);
+    IPC_PHASE_START(requestStart);
+    TensorWireHeader header;
+    torch::Tensor input = encodeRequest(matrix, header);
+    // write the tensor header at the beginning of shared memory
+    std::memcpy(shmAddr, &header, sizeof(header));
 
-    // immediately signal the child that totalElements is available
-    sem_post(sem_parent_to_child);
+    // immediately signal the child that the header is available
+    signalChild();
 
-    int batchSizeInBytes = shmSize - sizeof(int);                // adjusting for totalElements
-    int batchSize = batchSizeInBytes / sizeof(CPP_TENSOR_DTYPE); // elements per batch
-    auto ptr = matrix.data_ptr<CPP_TENSOR_DTYPE>();
-    char* batchPtr = static_cast<char*>(shmAddr) + sizeof(int);  // offset by size of int
+    // the result gets the layout (or encoding) of the input, so both are the same run of bytes
+    torch::Tensor result = emptyFromWire(header);
+    char* batchPtr = static_cast<char*>(shmAddr) + sizeof(header);  // offset by the header
 
-    // wait for child to acknowledge reading totalElements
-    sem_wait(sem_child_to_parent);
+    // wait for child to acknowledge reading the header
+    waitForChild();
 
-    torch::Tensor result = torch::empty({matrix.size(0), matrix.size(1)}, matrix.options());
-    auto resultPtr = result.data_ptr<CPP_TENSOR_DTYPE>();
+    const size_t totalBytes = wirePayloadBytes(header);
+    const size_t batchBytes = batchBytesFor(shmSize);
+    auto ptr = static_cast<const char*>(input.data_ptr());
+    auto resultPtr = static_cast<char*>(result.data_ptr());
 
-    for (int i = 0; i < totalElements;) {
-        int currentBatchSize = std::min(batchSize, totalElements - i);
-        int currentBatchBytes = currentBatchSize * sizeof(CPP_TENSOR_DTYPE);
+    for (size_t offset = 0; offset < totalBytes;) {
+        size_t currentBatchBytes = std::min(batchBytes, totalBytes - offset);
 
-        // copy current batch to shared memory after the totalElements
-        std::memcpy(batchPtr, ptr + i, currentBatchBytes);
+        // copy current batch to shared memory after the header
+        IPC_PHASE_START(writeStart);
+        std::memcpy(batchPtr, ptr + offset, currentBatchBytes);
 
         // signal child process that batch is ready
-        sem_post(sem_parent_to_child);
+        signalChild();
+        IPC_PHASE_ADD(parentTimes, PHASE_WRITE, writeStart);
 
         // wait for the child to signal back
-        sem_wait(sem_child_to_parent);
+        IPC_PHASE_START(readStart);
+        waitForChild();
 
         // read the squared matrix batch back from shared memory
-        std::memcpy(resultPtr + i, batchPtr, currentBatchSize * sizeof(CPP_TENSOR_DTYPE));
+        std::memcpy(resultPtr + offset, batchPtr, currentBatchBytes);
+        IPC_PHASE_ADD(parentTimes, PHASE_READ, readStart);
 
-        i += currentBatchSize; // update for the next iteration
+        offset += currentBatchBytes; // update for the next iteration
     }
-
+    result = decodeFromWire(result, header);
+
+    IPC_PHASE_COMMIT(phases, parentTimes);
+#ifdef IPC_ENABLE_PHASE_TIMING
+    PhaseTimes childTimes;
+    std::memcpy(&childTimes, static_cast<char*>(shmAddr) + shmSize - PHASE_TRAILER_BYTES, sizeof(childTimes));
+    phases.recordChild(childTimes, requestStart);
+#endif
     return result;
 }
 
 bool IPCSharedMemory::processMatrixInBatches() {
-    // wait for the parent signal that totalElements is ready
-    sem_wait(sem_parent_to_child);
-    // read totalElements from the beginning of shared memory
+    // wait for the parent signal that the header is ready
+    waitForParent();
+    // read the header from the beginning of shared memory
     if (sem_trywait(sem_exit) == 0) {
             DEBUG_PRINT(1, "SharedMem: Child process exiting...\n");
             return true; // exit the loop and thus the process
         }
-    int totalElements;
-    std::memcpy(&totalElements, shmAddr, sizeof(int));
-    // Signal back to parent that totalElements has been read
-    sem_post(sem_child_to_parent);
-    int batchSizeInBytes = shmSize - sizeof(int); // adjusting for totalElements
-    int batchSize = batchSizeInBytes / sizeof(CPP_TENSOR_DTYPE);
+    IPC_PHASE_TIMES(childTimes);
+    IPC_PHASE_MARK_WAKE(childTimes);
+    TensorWireHeader header;
+    std::memcpy(&header, shmAddr, sizeof(header));
+    if (!validWireHeader(header)) {
+        std::cerr << "SharedMem: Invalid tensor header in shared memory" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    // Signal back to parent that the header has been read
+    signalParent();
+
+    char* batchPtr = static_cast<char*>(shmAddr) + sizeof(header); // offset by the header
 
-    char* batchPtr = static_cast<char*>(shmAddr) + sizeof(int); // offset by size of int
+    // the op is elementwise, so every batch is processed as a flat run of elements, where it
+    // lies in shared memory: one pass, no copies or allocations. of a sparse payload only the
+    // values in front are touched; the indices go back as they came
+    const size_t totalBytes = wirePayloadBytes(header);
+    const size_t batchBytes = batchBytesFor(shmSize);
 
-    for (int i = 0; i < totalElements;) {
-        sem_wait(sem_parent_to_child); // wait for parent to signal batch is ready
+    for (size_t offset = 0; offset < totalBytes;) {
+        waitForParent(); // wait for parent to signal batch is ready
         if (sem_trywait(sem_exit) == 0) {
             std::cout << "SharedMem: Child process exiting...\n";
             return true; // exit the loop and thus the process
         }
 
-        int currentBatchSize = std::min(batchSize, totalElements - i);
-
-        // process the current batch here - since we need a Tensor for processing,
-        // we create one from the current batch in shared memory.
-        torch::Tensor batch = torch::from_blob(batchPtr, {currentBatchSize}, torch::kFloat32).clone();
+        size_t currentBatchBytes = std::min(batchBytes, totalBytes - offset);
+        IPC_PHASE_START(computeStart);
+        MatrixOperation::applyPayloadChunk(batchPtr, offset, currentBatchBytes, header);
+        IPC_PHASE_ADD(childTimes, PHASE_COMPUTE, computeStart);
 
-        // process the batch - square the elements
-        torch::Tensor squaredBatch = batch.square();
+        offset += currentBatchBytes; // update for the next iteration
+#ifdef IPC_ENABLE_PHASE_TIMING
+        // keep the trailer current; the parent reads it after the last batch
+        std::memcpy(static_cast<char*>(shmAddr) + shmSize - PHASE_TRAILER_BYTES, &childTimes, sizeof(childTimes));
+#endif
 
-        // write the processed batch back:
-        std::memcpy(batchPtr, squaredBatch.data_ptr<CPP_TENSOR_DTYPE>(), currentBatchSize * sizeof(CPP_TENSOR_DTYPE));
-
-        i += currentBatchSize; // update for the next iteration
-
-        sem_post(sem_child_to_parent); // signal back to parent
+        signalParent(); // signal back to parent
 
         // Check if the exit semaphore was posted after processing a batch
         if (sem_trywait(sem_exit) == 0) {
@@ -212,7 +484,7 @@ void IPCSharedMemory::exitSubprocess() {
     DEBUG_PRINT(1, "SharedMem: Parent process exiting...\n");
     // signal child process to exit
     sem_post(sem_exit);
-    sem_post(sem_parent_to_child);
+    signalChild();
     
     DEBUG_PRINT(1, "SharedMem: Parent process signaled child to exit\n");
 
@@ -222,21 +494,25 @@ void IPCSharedMemory::exitSubprocess() {
     }
     DEBUG_PRINT(1, "SharedMem: Parent process waited for child to exit\n");
     // Cleanup shared memory and semaphore resources
-    munmap(shmAddr, shmSize);           // Unmap shared memory
-    shm_unlink(shmName);                // Unlink shared memory object
+    if (shmAddr != nullptr) {
+        munmap(shmAddr, mapSize);       // Unmap shared memory
+        shmAddr = nullptr;
+    }
+    shm_unlink(shmName.c_str());        // Unlink shared memory object
     sem_close(sem_parent_to_child);     // Close semaphore
     sem_close(sem_child_to_parent);     // Close semaphore
     sem_close(sem_exit);                // Close semaphore
-    sem_unlink("/sem_parent_to_child"); // Unlink semaphore
-    sem_unlink("/sem_child_to_parent"); // Unlink semaphore
-    sem_unlink("/sem_exit");            // Unlink semaphore
+    sem_parent_to_child = sem_child_to_parent = sem_exit = nullptr;
+    sem_unlink(semParentToChildName.c_str()); // Unlink semaphore
+    sem_unlink(semChildToParentName.c_str()); // Unlink semaphore
+    sem_unlink(semExitName.c_str());          // Unlink semaphore
 
 }
 
 
 void IPCSharedMemory::sendAndReceive(int matrixSize){
-    const char* memname = "/dv_mk1_shared_memory";
-    shm_unlink(memname);
+    std::string memname = uniqueChannelName("/dv_mk1_shared_memory");
+    shm_unlink(memname.c_str());
     int memFd;
     void *shared_mem;
     size_t memSize = matrixSize * matrixSize * sizeof(CPP_TENSOR_DTYPE);
@@ -245,7 +521,7 @@ void IPCSharedMemory::sendAndReceive(int matrixSize){
     pid_t pid;
     
     // create shared memory object
-    memFd = shm_open(memname, O_CREAT | O_RDWR, 0666);
+    memFd = shm_open(memname.c_str(), O_CREAT | O_RDWR, 0666);
     if (memFd == -1) {
         perror("shm_open");
         exit(EXIT_FAILURE);
@@ -258,8 +534,8 @@ void IPCSharedMemory::sendAndReceive(int matrixSize){
         exit(EXIT_FAILURE);
     }
 
-    sem_parent_to_child = sem_open("/sem_parent_to_child", O_CREAT, 0666, 0);
-    sem_child_to_parent = sem_open("/sem_child_to_parent", O_CREAT, 0666, 0);
+    sem_parent_to_child = sem_open(semParentToChildName.c_str(), O_CREAT, 0666, 0);
+    sem_child_to_parent = sem_open(semChildToParentName.c_str(), O_CREAT, 0666, 0);
 
     // forking
     pid = fork();
@@ -329,15 +605,16 @@ void IPCSharedMemory::sendAndReceive(int matrixSize){
             perror("munmap");
             exit(EXIT_FAILURE);
         }
-        shm_unlink(memname);
+        shm_unlink(memname.c_str());
         // wait for child process to finish
         wait(nullptr);
 
         // cleanup
         sem_close(sem_parent_to_child);
         sem_close(sem_child_to_parent);
-        sem_unlink("/sem_parent_to_child");
-        sem_unlink("/sem_child_to_parent");
+        sem_parent_to_child = sem_child_to_parent = nullptr;
+        sem_unlink(semParentToChildName.c_str());
+        sem_unlink(semChildToParentName.c_str());
         // exit(0);
     }
 }
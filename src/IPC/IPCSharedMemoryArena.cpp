@@ -0,0 +1,220 @@
+#include "IPCSharedMemoryArena.h"
+#include "MatrixOperation.h"
+#include <iostream>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+IPCSharedMemoryArena::IPCSharedMemoryArena(size_t arenaBytes)
+    : shmName(uniqueChannelName("/dv_ipc_arena_mem")),
+      semRequestName(uniqueChannelName("/sem_arena_request")),
+      semResponseName(uniqueChannelName("/sem_arena_response")) {
+    sem_unlink(semRequestName.c_str());
+    sem_unlink(semResponseName.c_str());
+
+    sem_request = sem_open(semRequestName.c_str(), O_CREAT, 0666, 0);
+    if (sem_request == SEM_FAILED) {
+        perror("Error opening semaphore for arena request");
+        exit(EXIT_FAILURE);
+    }
+    sem_response = sem_open(semResponseName.c_str(), O_CREAT, 0666, 0);
+    if (sem_response == SEM_FAILED) {
+        perror("Error opening semaphore for arena response");
+        exit(EXIT_FAILURE);
+    }
+    DEBUG_PRINT(1, "SharedMemArena: Semaphores opened\n");
+
+    // layout: [ArenaRequest page][arena]
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    shmSize = pageSize + arenaBytes;
+
+    shm_unlink(shmName.c_str());
+    shmFd = shm_open(shmName.c_str(), O_CREAT | O_RDWR, 0666);
+    if (shmFd == -1) {
+        perror("shm_open");
+        exit(EXIT_FAILURE);
+    }
+    if (ftruncate(shmFd, shmSize) == -1) {
+        perror("ftruncate");
+        exit(EXIT_FAILURE);
+    }
+
+    // mapped once before fork so both processes see the arena at the same address
+    shmAddr = mmap(NULL, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    if (shmAddr == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    request = static_cast<ArenaRequest*>(shmAddr);
+    arenaBase = static_cast<char*>(shmAddr) + pageSize;
+
+    arena = std::make_unique<SharedTensorArena>(arenaBase, arenaBytes);
+    arena->adoptMapping(shmAddr, shmSize); // stays mapped while arena tensors are alive
+    DEBUG_PRINT(1, "SharedMemArena: Arena of " << arenaBytes << " bytes mapped\n");
+}
+
+IPCSharedMemoryArena::~IPCSharedMemoryArena() {
+    arena.reset(); // unmaps once the last arena tensor is released
+    if (shmFd != -1) {
+        close(shmFd);
+        shm_unlink(shmName.c_str());
+        shmFd = -1;
+    }
+    sem_close(sem_request);
+    sem_close(sem_response);
+    sem_unlink(semRequestName.c_str());
+    sem_unlink(semResponseName.c_str());
+    DEBUG_PRINT(1, "SharedMemArena: Cleaned up shared memory and semaphores in ~IPCSharedMemoryArena\n");
+}
+
+void IPCSharedMemoryArena::initSubprocess() {
+    request->exit = 0;
+    if (spawnsWorker()) {
+        // the worker opens segment and semaphores by name; blocks are named by offset, so
+        // it needn't map the arena at the parent's address
+        childPid = spawnWorker(methodName(), {{"shm", shmName},
+                                              {"request", semRequestName},
+                                              {"response", semResponseName}});
+        return;
+    }
+    childPid = fork();
+    if (childPid == -1) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    } else if (childPid == 0) { // child
+        DEBUG_PRINT(1, "SharedMemArena: Child process created\n");
+        serveRequests();
+        exit(0);
+    }
+    // parent continues without waiting here
+}
+
+// worker: release what the constructor set up and open the parent's channel in its place
+void IPCSharedMemoryArena::serveWorker(const ChannelArguments& args) {
+    arena.reset();
+    close(shmFd);
+    shm_unlink(shmName.c_str());
+    sem_close(sem_request);
+    sem_close(sem_response);
+    sem_unlink(semRequestName.c_str());
+    sem_unlink(semResponseName.c_str());
+
+    shmName = channelArgument(args, "shm");
+    semRequestName = channelArgument(args, "request");
+    semResponseName = channelArgument(args, "response");
+    sem_request = sem_open(semRequestName.c_str(), 0);
+    sem_response = sem_open(semResponseName.c_str(), 0);
+    if (sem_request == SEM_FAILED || sem_response == SEM_FAILED) {
+        perror("Error opening arena semaphores");
+        exit(EXIT_FAILURE);
+    }
+    shmFd = shm_open(shmName.c_str(), O_RDWR, 0666);
+    if (shmFd == -1) {
+        perror("shm_open");
+        exit(EXIT_FAILURE);
+    }
+    shmAddr = mmap(NULL, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    if (shmAddr == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    request = static_cast<ArenaRequest*>(shmAddr);
+    arenaBase = static_cast<char*>(shmAddr) + sysconf(_SC_PAGESIZE);
+    DEBUG_PRINT(1, "SharedMemArena: Worker attached to " << shmName << "\n");
+    serveRequests();
+}
+
+torch::Tensor IPCSharedMemoryArena::allocateMatrix(int rows, int cols, torch::ScalarType dtype) {
+    return allocateOrDie({rows, cols}, dtype);
+}
+
+torch::Tensor IPCSharedMemoryArena::allocateOrDie(at::IntArrayRef sizes, torch::ScalarType dtype) {
+    torch::Tensor tensor = arena->allocateTensor(sizes, dtype);
+    if (!tensor.defined()) {
+        std::cerr << "SharedMemArena: arena exhausted (" << arena->bytesInUse() << " of "
+                  << arena->capacity() << " bytes in use)" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return tensor;
+}
+
+// child: apply the op from the input block straight into the output block; the payload
+// bytes are only touched by the compute itself
+void IPCSharedMemoryArena::serveRequests() {
+    while (true) {
+        sem_wait(sem_request);
+        if (request->exit) {
+            DEBUG_PRINT(1, "SharedMemArena: Child process exiting...\n");
+            return;
+        }
+        IPC_PHASE_TIMES(childTimes);
+        IPC_PHASE_MARK_WAKE(childTimes);
+        IPC_PHASE_START(computeStart);
+        const MatrixOpInfo& op = MatrixOperation::operation(request->input.op);
+        if (op.elementwise() && (request->input.flags & request->output.flags & TENSOR_WIRE_CONTIGUOUS)) {
+            // same element order on both sides: one flat pass of the kernel
+            op.elements(arenaBase + request->inputOffset, arenaBase + request->outputOffset,
+                        wireElements(request->input), request->input.dtype);
+        } else {
+            torch::Tensor input = tensorFromWire(arenaBase + request->inputOffset, request->input);
+            torch::Tensor output = tensorFromWire(arenaBase + request->outputOffset, request->output);
+            output.copy_(op.apply(input));
+        }
+        IPC_PHASE_ADD(childTimes, PHASE_COMPUTE, computeStart);
+#ifdef IPC_ENABLE_PHASE_TIMING
+        request->childTimes = childTimes;
+#endif
+        sem_post(sem_response);
+    }
+}
+
+torch::Tensor IPCSharedMemoryArena::sendAndReceiveV2(const torch::Tensor& matrix) {
+    DEBUG_PRINT(1, "SharedMemArena: Parent process sending matrix to child process\n");
+    IPC_PHASE_TIMES(parentTimes);
+    IPC_PHASE_START(requestStart);
+    torch::Tensor input = matrix;
+    size_t bytes = matrix.numel() * matrix.element_size();
+    // a dense view (a transpose, say) of an arena block is squared where it is
+    if (!matrix.is_non_overlapping_and_dense() || !arena->contains(matrix.data_ptr(), bytes)) {
+        // matrix was not allocated through allocateMatrix: one copy into the arena
+        DEBUG_PRINT(2, "SharedMemArena: Matrix outside the arena, copying it in\n");
+        input = allocateOrDie(matrix.sizes(), matrix.scalar_type());
+        input.copy_(matrix);
+    }
+    torch::Tensor result = allocateOrDie(MatrixOperation::operation(matrixOp).resultShape(matrix.sizes()), matrix.scalar_type());
+    IPC_PHASE_ADD(parentTimes, PHASE_SERIALIZE, requestStart);
+
+    IPC_PHASE_START(writeStart);
+    request->inputOffset = arena->offsetOf(input.data_ptr());
+    request->outputOffset = arena->offsetOf(result.data_ptr());
+    request->input = describeTensor(input);
+    request->input.op = matrixOp;
+    request->output = describeTensor(result);
+    sem_post(sem_request);
+    IPC_PHASE_ADD(parentTimes, PHASE_WRITE, writeStart);
+    IPC_PHASE_START(readStart);
+    sem_wait(sem_response);
+    IPC_PHASE_ADD(parentTimes, PHASE_READ, readStart);
+
+    IPC_PHASE_COMMIT(phases, parentTimes);
+#ifdef IPC_ENABLE_PHASE_TIMING
+    phases.recordChild(request->childTimes, requestStart);
+#endif
+
+    DEBUG_PRINT(1, "SharedMemArena: Parent process received squared matrix\n");
+    return result;
+}
+
+void IPCSharedMemoryArena::exitSubprocess() {
+    DEBUG_PRINT(1, "SharedMemArena: Parent process exiting...\n");
+    request->exit = 1;
+    sem_post(sem_request);
+    if (childPid > 0) {
+        waitpid(childPid, nullptr, 0);
+        childPid = -1;
+    }
+    DEBUG_PRINT(1, "SharedMemArena: Parent process waited for child to exit\n");
+}
@@ -0,0 +1,335 @@
+#include "IPCSharedMemoryRing.h"
+#include "MatrixOperation.h"
+#include "WaitStrategy.h" // for cpuRelax
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstring> // for memcpy
+#include <algorithm>
+#include <future>
+#include <new>     // for placement new
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring indices must be lock-free to live in shared memory");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "ring exit flag must be lock-free to live in shared memory");
+
+// number of empty polls before a waiting side gives its core back with sched_yield
+static const int RING_SPIN_LIMIT = 1024;
+
+// spin for a while, then start yielding the core
+static inline void backoff(int& spins) {
+    if (++spins < RING_SPIN_LIMIT) {
+        cpuRelax();
+    } else {
+        sched_yield();
+    }
+}
+
+static size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+IPCSharedMemoryRing::IPCSharedMemoryRing(size_t slotCount, size_t slotBytes)
+    : shmName(uniqueChannelName("/dv_ipc_ring_mem")),
+      slotCount(slotCount),
+      slotBytes(slotBytes / sizeof(int64_t) * sizeof(int64_t)) {
+    // layout: [RingControl][RingSlot x slotCount][payload x slotCount], payload page aligned
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t headerBytes = alignUp(sizeof(RingControl) + slotCount * sizeof(RingSlot), pageSize);
+    shmSize = headerBytes + slotCount * this->slotBytes;
+
+    shm_unlink(shmName.c_str());
+    shmFd = shm_open(shmName.c_str(), O_CREAT | O_RDWR, 0666);
+    if (shmFd == -1) {
+        perror("shm_open");
+        exit(EXIT_FAILURE);
+    }
+    if (ftruncate(shmFd, shmSize) == -1) {
+        perror("ftruncate");
+        exit(EXIT_FAILURE);
+    }
+
+    // map once; the child inherits the mapping across fork
+    mapSegment();
+
+    control = new (shmAddr) RingControl();
+    control->head.store(0, std::memory_order_relaxed);
+    control->processed.store(0, std::memory_order_relaxed);
+    control->tail.store(0, std::memory_order_relaxed);
+    control->exitFlag.store(0, std::memory_order_relaxed);
+#ifdef IPC_ENABLE_PHASE_TIMING
+    control->childTimes.clear();
+#endif
+    slots = new (slots) RingSlot[slotCount]();
+    DEBUG_PRINT(1, "SharedMemRing: Segment of " << shmSize << " bytes with " << slotCount << " slots created\n");
+}
+
+// map shmFd and point control, slots and payload into it, as laid out by the constructor
+void IPCSharedMemoryRing::mapSegment() {
+    shmAddr = mmap(NULL, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    if (shmAddr == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    size_t headerBytes = shmSize - slotCount * slotBytes;
+    control = static_cast<RingControl*>(shmAddr);
+    slots = reinterpret_cast<RingSlot*>(static_cast<char*>(shmAddr) + sizeof(RingControl));
+    payload = static_cast<char*>(shmAddr) + headerBytes;
+}
+
+IPCSharedMemoryRing::~IPCSharedMemoryRing() {
+    if (shmAddr != nullptr) {
+        munmap(shmAddr, shmSize);
+        shmAddr = nullptr;
+    }
+    if (shmFd != -1) {
+        close(shmFd);
+        shm_unlink(shmName.c_str());
+        shmFd = -1;
+    }
+    DEBUG_PRINT(1, "SharedMemRing: Cleaned up shared memory in ~IPCSharedMemoryRing\n");
+}
+
+char* IPCSharedMemoryRing::slotData(uint64_t index) const {
+    return payload + (index % slotCount) * slotBytes;
+}
+
+void IPCSharedMemoryRing::initSubprocess() {
+    control->exitFlag.store(0, std::memory_order_relaxed);
+    if (spawnsWorker()) {
+        // the worker maps the segment by name; the constructor's sizes are the same there
+        childPid = spawnWorker(methodName(), {{"shm", shmName}});
+        return;
+    }
+    childPid = fork();
+    if (childPid == -1) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    } else if (childPid == 0) { // child
+        DEBUG_PRINT(1, "SharedMemRing: Child process created\n");
+        processRing();
+        munmap(shmAddr, shmSize);
+        exit(0);
+    }
+    // parent continues without waiting here
+}
+
+// worker: drop the segment the constructor made and map the parent's as it is, indices and all
+void IPCSharedMemoryRing::serveWorker(const ChannelArguments& args) {
+    munmap(shmAddr, shmSize);
+    close(shmFd);
+    shm_unlink(shmName.c_str());
+
+    shmName = channelArgument(args, "shm");
+    shmFd = shm_open(shmName.c_str(), O_RDWR, 0666);
+    if (shmFd == -1) {
+        perror("shm_open");
+        exit(EXIT_FAILURE);
+    }
+    mapSegment();
+    DEBUG_PRINT(1, "SharedMemRing: Worker attached to " << shmName << "\n");
+    processRing();
+}
+
+// child: apply the op of every slot the parent publishes, in place, and hand it back
+void IPCSharedMemoryRing::processRing() {
+    uint64_t processed = control->processed.load(std::memory_order_relaxed);
+    int spins = 0;
+    while (true) {
+        uint64_t head = control->head.load(std::memory_order_acquire);
+        if (processed == head) {
+            if (control->exitFlag.load(std::memory_order_acquire)) {
+                DEBUG_PRINT(1, "SharedMemRing: Child process exiting...\n");
+                return;
+            }
+            backoff(spins);
+            continue;
+        }
+        if (spins > 0) {
+            IPC_PHASE_MARK_WAKE(control->childTimes); // idle -> busy
+        }
+        spins = 0;
+
+        // process every slot published so far, handing each back as soon as it is done
+        while (processed != head) {
+            const RingSlot& slot = slots[processed % slotCount];
+            int64_t elements = slot.bytes / wireElementSize(slot.dtype);
+            IPC_PHASE_START(computeStart);
+            MatrixOperation::operation(slot.op).elements(slotData(processed), slotData(processed), elements, slot.dtype);
+            IPC_PHASE_ADD(control->childTimes, PHASE_COMPUTE, computeStart);
+            ++processed;
+            control->processed.store(processed, std::memory_order_release);
+        }
+    }
+}
+
+torch::Tensor IPCSharedMemoryRing::sendAndReceiveV2(const torch::Tensor& matrix) {
+    completions.drain(); // the synchronous path advances tail itself
+    DEBUG_PRINT(1, "SharedMemRing: Parent process sending matrix to child process\n");
+    // the op is elementwise: the slots carry the input's elements in memory order, and
+    // the result gets the same layout
+    torch::Tensor input = wireLayout(matrix);
+    TensorWireHeader header = describeTensor(input);
+    const int64_t totalBytes = wirePayloadBytes(header);
+    auto src = static_cast<const char*>(input.data_ptr());
+
+    torch::Tensor result = emptyFromWire(header);
+    auto dst = static_cast<char*>(result.data_ptr());
+
+    IPC_PHASE_TIMES(parentTimes);
+    IPC_PHASE_START(requestStart);
+#ifdef IPC_ENABLE_PHASE_TIMING
+    // the child is idle between requests, so its cumulative times are stable here
+    PhaseTimes childBefore = control->childTimes;
+#endif
+
+    // head and tail are only ever written by the parent
+    uint64_t head = control->head.load(std::memory_order_relaxed);
+    uint64_t tail = control->tail.load(std::memory_order_relaxed);
+    int64_t sent = 0, received = 0;
+    int spins = 0;
+
+    // keep filling free slots while the child works on earlier ones and copy finished slots
+    // back as soon as they show up, so transfer, compute and copy-back overlap
+    while (received < totalBytes) {
+        bool progressed = false;
+
+        if (sent < totalBytes && head - tail < slotCount) {
+            IPC_PHASE_START(writeStart);
+            size_t bytes = std::min(static_cast<int64_t>(slotBytes), totalBytes - sent);
+            std::memcpy(slotData(head), src + sent, bytes);
+            slots[head % slotCount].bytes = static_cast<uint32_t>(bytes);
+            slots[head % slotCount].dtype = header.dtype;
+            slots[head % slotCount].op = matrixOp;
+            slots[head % slotCount].requestId = 0;
+            ++head;
+            control->head.store(head, std::memory_order_release);
+            IPC_PHASE_ADD(parentTimes, PHASE_WRITE, writeStart);
+            sent += bytes;
+            progressed = true;
+        }
+
+        uint64_t processed = control->processed.load(std::memory_order_acquire);
+        if (tail != processed) {
+            IPC_PHASE_START(readStart);
+            while (tail != processed) {
+                uint32_t bytes = slots[tail % slotCount].bytes;
+                std::memcpy(dst + received, slotData(tail), bytes);
+                received += bytes;
+                ++tail;
+            }
+            control->tail.store(tail, std::memory_order_release);
+            IPC_PHASE_ADD(parentTimes, PHASE_READ, readStart);
+            progressed = true;
+        }
+
+        if (progressed) {
+            spins = 0;
+        } else {
+            backoff(spins);
+        }
+    }
+
+    IPC_PHASE_COMMIT(phases, parentTimes);
+#ifdef IPC_ENABLE_PHASE_TIMING
+    // every slot of this request is processed, so the child's updates are visible
+    PhaseTimes childDelta = control->childTimes;
+    for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+        childDelta.ns[phase] -= childBefore.ns[phase];
+    }
+    phases.recordChild(childDelta, requestStart);
+#endif
+
+    DEBUG_PRINT(1, "SharedMemRing: Parent process received squared matrix\n");
+    return result;
+}
+
+std::future<torch::Tensor> IPCSharedMemoryRing::submit(const torch::Tensor& matrix) {
+    torch::Tensor input = wireLayout(matrix);
+    TensorWireHeader header = describeTensor(input);
+    torch::Tensor result = emptyFromWire(header);
+    const int64_t totalBytes = wirePayloadBytes(header);
+    if (totalBytes == 0) {
+        std::promise<torch::Tensor> promise;
+        promise.set_value(result);
+        return promise.get_future();
+    }
+
+    std::future<torch::Tensor> future;
+    uint64_t requestId = completions.begin(future, result, maxInFlight(), [this] { completeOneRequest(); });
+
+    // the input is copied into the ring here, so the caller may reuse it once submit returns.
+    // slots are freed by the completion thread as it copies results out.
+    auto src = static_cast<const char*>(input.data_ptr());
+    uint64_t head = control->head.load(std::memory_order_relaxed);
+    int64_t sent = 0;
+    int spins = 0;
+    while (sent < totalBytes) {
+        if (head - control->tail.load(std::memory_order_acquire) >= slotCount) {
+            backoff(spins);
+            continue;
+        }
+        spins = 0;
+        size_t bytes = std::min(static_cast<int64_t>(slotBytes), totalBytes - sent);
+        std::memcpy(slotData(head), src + sent, bytes);
+        slots[head % slotCount].bytes = static_cast<uint32_t>(bytes);
+        slots[head % slotCount].dtype = header.dtype;
+        slots[head % slotCount].op = matrixOp;
+        slots[head % slotCount].requestId = requestId;
+        ++head;
+        control->head.store(head, std::memory_order_release);
+        sent += bytes;
+    }
+    DEBUG_PRINT(1, "SharedMemRing: Parent submitted request " << requestId << "\n");
+    return future;
+}
+
+// completion thread: copy the slots of the oldest outstanding request back into its result,
+// releasing each slot as soon as it is copied, and stop at the request boundary
+void IPCSharedMemoryRing::completeOneRequest() {
+    uint64_t tail = control->tail.load(std::memory_order_relaxed);
+    uint64_t requestId = 0;
+    torch::Tensor result;
+    char* dst = nullptr;
+    int64_t received = 0, totalBytes = 0;
+    int spins = 0;
+    while (true) {
+        uint64_t processed = control->processed.load(std::memory_order_acquire);
+        if (tail == processed) {
+            backoff(spins);
+            continue;
+        }
+        spins = 0;
+        while (tail != processed) {
+            const RingSlot& slot = slots[tail % slotCount];
+            if (!result.defined()) {
+                requestId = slot.requestId;
+                result = completions.buffer(requestId);
+                dst = static_cast<char*>(result.data_ptr());
+                totalBytes = result.numel() * result.element_size();
+            }
+            std::memcpy(dst + received, slotData(tail), slot.bytes);
+            received += slot.bytes;
+            ++tail;
+            control->tail.store(tail, std::memory_order_release);
+            if (received == totalBytes) {
+                completions.complete(requestId, result);
+                return;
+            }
+        }
+    }
+}
+
+void IPCSharedMemoryRing::exitSubprocess() {
+    DEBUG_PRINT(1, "SharedMemRing: Parent process exiting...\n");
+    completions.drain();
+    control->exitFlag.store(1, std::memory_order_release);
+    if (childPid > 0) {
+        waitpid(childPid, nullptr, 0);
+        childPid = -1;
+    }
+    DEBUG_PRINT(1, "SharedMemRing: Parent process waited for child to exit\n");
+}
@@ -1,18 +1,58 @@
 #include "IPCSocket.h"
+#include "BufferPool.h"
 #include "MatrixOperation.h"
 #include <iostream>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <algorithm>
 #include <cstring>
-
-IPCSocket::IPCSocket() {
+#include <errno.h>
+#include <poll.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <linux/errqueue.h> // for sock_extended_err
+#endif
+
+// payloads smaller than this are cheaper to copy than to pin and wait for a completion
+static const size_t ZEROCOPY_THRESHOLD = 64 * 1024;
+
+IPCSocket::IPCSocket(bool zeroCopy, int port, IoUringMode ioUring, bool streaming)
+    : customPort(port), zeroCopy(zeroCopy && !streaming), streaming(streaming),
+      ioUringMode(zeroCopy || streaming ? IO_URING_OFF : ioUring) {
     // initializing socket descriptors to -1 indicating they're not yet setup
     serverFd = -1;
     clientFd = -1;
 }
 
+std::string IPCSocket::methodName() const {
+    if (zeroCopy) {
+        return "SocketZeroCopy";
+    }
+    if (streaming) {
+        return "SocketStream";
+    }
+    switch (ioUringMode) {
+    case IO_URING_ON:     return "SocketIoUring";
+    case IO_URING_SQPOLL: return "SocketIoUringSqpoll";
+    default:              return "Socket";
+    }
+}
+
+// rings are per process (and per thread), so each side sets up its own once clientFd is
+// connected. a side without io_uring keeps using sendmsg/read on the same frames.
+void IPCSocket::setupIoUring() {
+    if (ioUringMode == IO_URING_OFF) {
+        return;
+    }
+    if (!sendRing.init(ioUringMode, {clientFd}) || !receiveRing.init(ioUringMode, {clientFd})) {
+        sendRing.close();
+        receiveRing.close();
+        DEBUG_PRINT(1, "Socket: io_uring unavailable, using sendmsg/read\n");
+    }
+}
+
 // destructor: ensure clean resource release
 IPCSocket::~IPCSocket() {
     closeSockets();
@@ -68,139 +108,357 @@ void IPCSocket::initSubprocess() {
         exit(EXIT_FAILURE);
     }
 
-    childPid = fork();
+    // learn which port the kernel picked, the child connects to it
+    socklen_t addressLen = sizeof(address);
+    if (getsockname(serverFd, (struct sockaddr *)&address, &addressLen) < 0) {
+        perror("getsockname");
+        close(serverFd);
+        exit(EXIT_FAILURE);
+    }
+    customPort = ntohs(address.sin_port);
+    DEBUG_PRINT(1, "Socket: Parent listening on port " << customPort << "\n");
+
+    if (spawnsWorker()) {
+        closeOnExec(serverFd); // the worker connects to the port, it doesn't listen
+        childPid = spawnWorker(methodName(), {{"port", std::to_string(customPort)}});
+    } else {
+        childPid = fork();
+    }
     if (childPid == -1) {
         perror("fork");
         close(serverFd);
         exit(EXIT_FAILURE);
     } else if (childPid == 0) { // Child process
         close(serverFd); // close server socket in child
-
-        // child process: setup client socket to connect back to the parent
-        clientFd = socket(AF_INET, SOCK_STREAM, 0);
+        serveFromPort(customPort);
+        exit(0); // ensure child exits cleanly after processing
+    } else {
+        // parent process: Accept connection from child
+        struct sockaddr_in clientAddr;
+        socklen_t clientLen = sizeof(clientAddr);
+        clientFd = accept(serverFd, (struct sockaddr *)&clientAddr, &clientLen);
         if (clientFd < 0) {
-            perror("socket failed in child");
+            perror("accept");
+            close(serverFd);
             exit(EXIT_FAILURE);
         }
-
-        // attempt to connect to the parent server
-        while (connect(clientFd, (struct sockaddr *)&address, sizeof(address)) < 0) {
-            sleep(1); // retry after delay if connection fails
+        if (zeroCopy) {
+            enableZeroCopy(clientFd);
         }
-        // enter loop to wait for messages from the parent
-        while (true) {
-            torch::Tensor matrix;
-            int matrixSize;
-            
-            // wait for the first piece of data to dictate action
-            ssize_t bytes_read = read_full(clientFd, reinterpret_cast<char*>(&matrixSize), sizeof(matrixSize));
-            
-            // check for termination signal
-            if (matrixSize == -25) {
-                break; // Exit the loop for cleanup
-            }
+        setupIoUring();
+        // Connection established; server socket is left open for continuous listening
+    }
+}
+
+// child: connect back to the parent listening on port and serve it
+void IPCSocket::serveFromPort(int port) {
+    struct sockaddr_in address;
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+
+    clientFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (clientFd < 0) {
+        perror("socket failed in child");
+        exit(EXIT_FAILURE);
+    }
+    if (zeroCopy) {
+        enableZeroCopy(clientFd);
+    }
+
+    // attempt to connect to the parent server
+    while (connect(clientFd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        sleep(1); // retry after delay if connection fails
+    }
+    setupIoUring();
+    serveClient();
+}
 
-            // deserialize tensor received from parent
-            auto receivedTensor = receiveTensor(clientFd, matrixSize);
+void IPCSocket::serveWorker(const ChannelArguments& args) {
+    serveFromPort(channelNumber(args, "port"));
+}
 
-            DEBUG_PRINT(1, "Socket: Child received matrix from parent\n");
-            // MatrixOperation::printMatrix(receivedTensor);
+void IPCSocket::serveClient() {
+    // enter loop to wait for messages from the parent
+    while (true) {
+        TensorFrameHeader header;
 
-            // perform the operation on the tensor (e.g., squaring)
-            auto processedTensor = receivedTensor.square();
+        // wait for the first piece of data to dictate action
+        ssize_t bytes_read = read_full(clientFd, reinterpret_cast<char*>(&header), sizeof(header));
 
-            // serialize and send the processed tensor back to the parent
-            sendTensor(clientFd, processedTensor);
-            DEBUG_PRINT(1, "Socket: Child sent matrix to parent\n");
-            // MatrixOperation::printMatrix(processedTensor);
+        // check for termination signal (or the parent going away)
+        if (bytes_read != sizeof(header) || header.terminate) {
+            break; // Exit the loop for cleanup
+        }
+        if (!validWireHeader(header.tensor)) {
+            std::cerr << "Socket: Received an invalid tensor header." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        IPC_PHASE_TIMES(childTimes);
+        IPC_PHASE_MARK_WAKE(childTimes);
+
+        if (streaming) {
+            // read, compute and write overlap, so all of it counts as compute
+            IPC_PHASE_START(streamStart);
+            streamApply(header);
+            IPC_PHASE_ADD(childTimes, PHASE_COMPUTE, streamStart);
+#ifdef IPC_ENABLE_PHASE_TIMING
+            write_full(clientFd, reinterpret_cast<char*>(&childTimes), sizeof(childTimes));
+#endif
+            continue;
         }
 
-        // cleanup before exiting
-        if (clientFd != -1) {
-            close(clientFd);
-            clientFd = -1;
+        // deserialize tensor received from parent
+        IPC_PHASE_START(readStart);
+        torch::Tensor receivedTensor;
+        if (receiveRing.available()) {
+            // into the ring's registered buffer; the tensor borrows it until the next request
+            ssize_t bufferSize = wirePayloadBytes(header.tensor);
+            char* staging = receiveRing.stagingBuffer(bufferSize);
+            if (read_full(clientFd, staging, bufferSize) != bufferSize) {
+                std::cerr << "Socket: Did not receive the entire matrix." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            receivedTensor = tensorFromWire(staging, header.tensor);
+        } else {
+            receivedTensor = receivePayload(clientFd, header.tensor);
         }
+        IPC_PHASE_ADD(childTimes, PHASE_CHILD_READ, readStart);
+
+        DEBUG_PRINT(1, "Socket: Child received matrix from parent\n");
+        // MatrixOperation::printMatrix(receivedTensor);
+
+        // perform the requested operation on the tensor. elementwise ops answer a sparse
+        // request sparse, under the same indices
+        IPC_PHASE_START(computeStart);
+        TensorWireHeader resultHeader = header.tensor;
+        auto processedTensor = MatrixOperation::applyPayload(receivedTensor, resultHeader);
+        IPC_PHASE_ADD(childTimes, PHASE_COMPUTE, computeStart);
+
+        // send the processed tensor back to the parent
+        IPC_PHASE_START(writeStart);
+        sendTensor(clientFd, processedTensor, resultHeader, header.requestId);
+        IPC_PHASE_ADD(childTimes, PHASE_CHILD_WRITE, writeStart);
+        DEBUG_PRINT(1, "Socket: Child sent matrix to parent\n");
+        // MatrixOperation::printMatrix(processedTensor);
+#ifdef IPC_ENABLE_PHASE_TIMING
+        // ship the child's phase times back behind the result
+        write_full(clientFd, reinterpret_cast<char*>(&childTimes), sizeof(childTimes));
+#endif
+
+        // release results whose zerocopy sends already completed, without blocking
+        reapZeroCopyCompletions(clientFd, false);
+    }
+    reapZeroCopyCompletions(clientFd, true);
 
-        exit(0); // ensure child exits cleanly after processing
-    } else {
-        // parent process: Accept connection from child
-        struct sockaddr_in clientAddr;
-        socklen_t clientLen = sizeof(clientAddr);
-        clientFd = accept(serverFd, (struct sockaddr *)&clientAddr, &clientLen);
-        if (clientFd < 0) {
-            perror("accept");
-            close(serverFd);
+    // cleanup before exiting
+    if (clientFd != -1) {
+        close(clientFd);
+        clientFd = -1;
+    }
+}
+
+// the result frame goes out as soon as the request frame header is in; an elementwise op keeps
+// the layout, so the tensor header is the same. then each chunk is processed and sent back while
+// the parent is still sending the next ones, with one chunk buffered here and the socket buffers'
+// worth in flight. the chunk is a multiple of the seqpacket message size, so message
+// boundaries line up on both sides
+void IPCSocket::streamApply(const TensorFrameHeader& header) {
+    if (write_full(clientFd, reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header)) {
+        perror("write");
+        exit(EXIT_FAILURE);
+    }
+    if (!streamChunk.defined() || streamChunk.numel() == 0) {
+        streamChunk = torch::empty({TENSOR_WIRE_STREAM_CHUNK}, torch::kUInt8);
+    }
+    char* chunk = static_cast<char*>(streamChunk.data_ptr());
+    const size_t totalBytes = wirePayloadBytes(header.tensor);
+    for (size_t offset = 0; offset < totalBytes;) {
+        size_t chunkBytes = std::min<size_t>(TENSOR_WIRE_STREAM_CHUNK, totalBytes - offset);
+        if (read_full(clientFd, chunk, chunkBytes) != static_cast<ssize_t>(chunkBytes)) {
+            std::cerr << "Socket: Did not receive the entire matrix." << std::endl;
             exit(EXIT_FAILURE);
         }
-        // Connection established; server socket is left open for continuous listening
+        MatrixOperation::applyPayloadChunk(chunk, offset, chunkBytes, header.tensor);
+        if (write_full(clientFd, chunk, chunkBytes) != static_cast<ssize_t>(chunkBytes)) {
+            perror("write");
+            exit(EXIT_FAILURE);
+        }
+        offset += chunkBytes;
     }
+    DEBUG_PRINT(1, "Socket: Child streamed " << totalBytes << " bytes back\n");
 }
 
 torch::Tensor IPCSocket::sendAndReceiveV2(const torch::Tensor& matrix) {
-    sendTensor(clientFd, matrix);
+    if (streaming) {
+        // results start coming back while the request is still being sent, so something has
+        // to read them meanwhile or both socket buffers fill up: the completion thread
+        return submit(matrix).get();
+    }
+    completions.drain(); // the synchronous path reads the socket itself
+    IPC_PHASE_TIMES(parentTimes);
+    IPC_PHASE_START(requestStart);
+    TensorWireHeader tensorHeader;
+    torch::Tensor payload = encodeRequest(matrix, tensorHeader);
+    IPC_PHASE_ADD(parentTimes, PHASE_SERIALIZE, requestStart);
+
+    IPC_PHASE_START(writeStart);
+    sendTensor(clientFd, payload, tensorHeader);
+    IPC_PHASE_ADD(parentTimes, PHASE_WRITE, writeStart);
     DEBUG_PRINT(1, "Socket: Parent sent matrix to child\n");
     // MatrixOperation::printMatrix(matrix);
     
     // receive the processed tensor from the child
+    IPC_PHASE_START(readStart);
     auto resultTensor = receiveTensor(clientFd);
+    IPC_PHASE_ADD(parentTimes, PHASE_READ, readStart);
     DEBUG_PRINT(1, "Socket: Parent received matrix from child\n");
     // MatrixOperation::printMatrix(resultTensor);
+
+    IPC_PHASE_COMMIT(phases, parentTimes);
+#ifdef IPC_ENABLE_PHASE_TIMING
+    PhaseTimes childTimes;
+    if (read_full(clientFd, reinterpret_cast<char*>(&childTimes), sizeof(childTimes)) == sizeof(childTimes)) {
+        phases.recordChild(childTimes, requestStart);
+    }
+#endif
+
+    // the caller owns matrix again once we return, so its zerocopy send must be complete
+    reapZeroCopyCompletions(clientFd, true);
     return resultTensor;
 }
 
-void IPCSocket::sendTensor(int socketFd, const torch::Tensor& tensor) {
-    // serialize the tensor into a buffer
-    auto buffer = serializeTensor(tensor);
-    // send the buffer size first
-    int64_t bufferSize = buffer.size();
-    int matrixSize = tensor.size(0); // assuming square matrix
-    write_full(socketFd, reinterpret_cast<char*>(&matrixSize), sizeof(matrixSize));
-    // send the buffer content
-    write_full(socketFd, buffer.data(), buffer.size());
+std::future<torch::Tensor> IPCSocket::submit(const torch::Tensor& matrix) {
+    TensorWireHeader tensorHeader;
+    torch::Tensor payload = encodeRequest(matrix, tensorHeader);
+    std::future<torch::Tensor> future;
+    uint64_t requestId = completions.begin(future, payload, maxInFlight(), [this] { completeOneRequest(); });
+    sendTensor(clientFd, payload, tensorHeader, requestId);
+    DEBUG_PRINT(1, "Socket: Parent submitted request " << requestId << "\n");
+    // unpin earlier zerocopy sends without waiting; exitSubprocess waits for the rest
+    reapZeroCopyCompletions(clientFd, false);
+    return future;
 }
 
-torch::Tensor IPCSocket::receiveTensor(int socketFd, int matrixSize) {
-    // receive the buffer size first
-    ssize_t bytes_read;
-    if (matrixSize == -1) {
-        bytes_read = read_full(socketFd, reinterpret_cast<char*>(&matrixSize), sizeof(matrixSize));
-        DEBUG_PRINT(1, "Socket:Child Read "<<bytes_read<<" bytes\n");
-        // allocate buffer for the tensor data
+// completion thread: results come back in the order the child serves them
+void IPCSocket::completeOneRequest() {
+    uint64_t requestId = 0;
+    torch::Tensor result = receiveTensor(clientFd, &requestId);
+#ifdef IPC_ENABLE_PHASE_TIMING
+    PhaseTimes childTimes;
+    if (read_full(clientFd, reinterpret_cast<char*>(&childTimes), sizeof(childTimes)) == sizeof(childTimes)) {
+        phases.recordChild(childTimes, completions.submittedNs(requestId));
     }
-    int64_t bufferSize = matrixSize * matrixSize * sizeof(CPP_TENSOR_DTYPE);
-    std::vector<char> buffer(bufferSize);
-    
-    // receive the buffer content
-    bytes_read = read_full(socketFd, buffer.data(), bufferSize);
-    DEBUG_PRINT(1, "Socket:Child Read "<<bytes_read<<" bytes\n");
-    
-    // deserialize the buffer into a tensor
-    auto tensor = deserializeTensor(buffer, {matrixSize, matrixSize});
-    return tensor;
+#endif
+    completions.complete(requestId, result);
 }
 
-// function to serialize the tensor
-std::vector<char> IPCSocket::serializeTensor(const torch::Tensor &tensor){
-    auto d_ptr = tensor.data_ptr<CPP_TENSOR_DTYPE>();
-    auto num_bytes = tensor.numel() * sizeof(CPP_TENSOR_DTYPE);
-    std::vector<char> buffer(num_bytes);
-    std::memcpy(buffer.data(), d_ptr, num_bytes);
-    return buffer;
+// send the frame header and the payload straight from the tensor, in a single sendmsg unless
+// the payload goes out zero-copy
+void IPCSocket::sendTensor(int socketFd, const torch::Tensor& payload, const TensorWireHeader& tensorHeader, uint64_t requestId) {
+    TensorFrameHeader header;
+    header.terminate = 0;
+    header.reserved = 0;
+    header.requestId = requestId;
+    header.tensor = tensorHeader;
+    char* data = static_cast<char*>(payload.data_ptr());
+    size_t numBytes = wirePayloadBytes(header.tensor);
+
+    if (sendRing.available() && socketFd == clientFd) {
+        // header and payload in a single submission
+        sendRing.queueWrite(socketFd, &header, sizeof(header));
+        sendRing.queueWrite(socketFd, data, numBytes);
+        if (sendRing.transferAll() == -1) {
+            perror("io_uring write");
+            exit(EXIT_FAILURE);
+        }
+        return;
+    }
+
+    if (maxMessageSize > 0) {
+        // message oriented socket: header and payload chunks stay separate messages
+        write_full(socketFd, reinterpret_cast<char*>(&header), sizeof(header));
+        write_full(socketFd, data, numBytes);
+        return;
+    }
+
+    struct iovec iov[2];
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = data;
+    iov[1].iov_len = numBytes;
+
+#ifdef MSG_ZEROCOPY
+    if (zeroCopy && numBytes >= ZEROCOPY_THRESHOLD) {
+        // the kernel may refer to zero-copy pages after sendmsg returns, and the header lives
+        // on this stack frame: it is copied into the socket, corked behind MSG_MORE, and only
+        // the pinned payload goes out zero-copy
+        bool zeroCopied = false;
+        if (sendmsg_full(socketFd, iov, 1, MSG_MORE) < 0 ||
+            sendmsg_full(socketFd, iov + 1, 1, MSG_ZEROCOPY, &zeroCopied) < 0) {
+            perror("sendmsg failed");
+            exit(EXIT_FAILURE);
+        }
+        if (zeroCopied) {
+            // keep the storage alive until the kernel is done with it
+            zeroCopyPinned.emplace_back(zeroCopySent, payload);
+        }
+        return;
+    }
+#endif
+    if (sendmsg_full(socketFd, iov, 2, 0) < 0) {
+        perror("sendmsg failed");
+        exit(EXIT_FAILURE);
+    }
 }
 
-// function to deserialize the tensor
-torch::Tensor IPCSocket::deserializeTensor(const std::vector<char> &buffer, const std::vector<int64_t> &size){
-    torch::Tensor tensor = torch::from_blob((void*)buffer.data(), at::IntArrayRef(size), MATRIX_DTYPE).clone();
+// receive the frame header, then the payload straight into a freshly allocated tensor, and
+// decode it
+torch::Tensor IPCSocket::receiveTensor(int socketFd, uint64_t* requestId) {
+    TensorFrameHeader header;
+    ssize_t bytes_read = read_full(socketFd, reinterpret_cast<char*>(&header), sizeof(header));
+    DEBUG_PRINT(1, "Socket:Child Read "<<bytes_read<<" bytes\n");
+    if (bytes_read != sizeof(header) || !validWireHeader(header.tensor)) {
+        std::cerr << "Socket: Did not receive the frame header." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (requestId != nullptr) {
+        *requestId = header.requestId;
+    }
+    return decodeFromWire(receivePayload(socketFd, header.tensor), header.tensor);
+}
+
+// receive straight into the storage of a freshly allocated tensor
+torch::Tensor IPCSocket::receivePayload(int socketFd, const TensorWireHeader& header) {
+    torch::Tensor tensor = emptyFromWire(header);
+    ssize_t bufferSize = wirePayloadBytes(header);
+
+    // receive the buffer content
+    ssize_t bytes_read = read_full(socketFd, static_cast<char*>(tensor.data_ptr()), bufferSize);
+    DEBUG_PRINT(1, "Socket:Child Read "<<bytes_read<<" bytes\n");
+    if (bytes_read != bufferSize) {
+        std::cerr << "Socket: Did not receive the entire matrix." << std::endl;
+        exit(EXIT_FAILURE);
+    }
     return tensor;
 }
 
 // attempt to read exactly 'count' bytes from 'fd' into 'buf'.
 // returns the number of bytes read, or -1 on error.
 ssize_t IPCSocket::read_full(int fd, char *buf, size_t count) {
+    if (receiveRing.available() && fd == clientFd) {
+        ssize_t res = receiveRing.readFull(fd, buf, count);
+        if (res < 0) {
+            perror("Read error");
+        }
+        return res;
+    }
     size_t total_read = 0;
     while (total_read < count) {
-        // Print the arguments to the read function
-        ssize_t res = read(fd, buf + total_read, count - total_read);
+        // message oriented sockets must read exactly the chunks the writer sent
+        size_t chunk = count - total_read;
+        if (maxMessageSize > 0 && chunk > maxMessageSize) chunk = maxMessageSize;
+        ssize_t res = read(fd, buf + total_read, chunk);
         if (res < 0) {
             if (errno == EINTR) continue; // if interrupted by signal, try again
             // print the read error
@@ -216,9 +474,15 @@ ssize_t IPCSocket::read_full(int fd, char *buf, size_t count) {
 // attempt to write exactly 'count' bytes from 'buf' to 'fd'.
 // returns the number of bytes written, or -1 on error.
 ssize_t IPCSocket::write_full(int fd, const char *buf, size_t count) {
+    if (sendRing.available() && fd == clientFd) {
+        return sendRing.writeFull(fd, buf, count);
+    }
     size_t total_written = 0;
     while (total_written < count) {
-        ssize_t res = write(fd, buf + total_written, count - total_written);
+        // message oriented sockets can't take a message larger than the send buffer
+        size_t chunk = count - total_written;
+        if (maxMessageSize > 0 && chunk > maxMessageSize) chunk = maxMessageSize;
+        ssize_t res = write(fd, buf + total_written, chunk);
         if (res < 0) {
             if (errno == EINTR) continue; // if interrupted by signal, try again
             return -1; // return error on actual write error
@@ -229,6 +493,119 @@ ssize_t IPCSocket::write_full(int fd, const char *buf, size_t count) {
 }
 
 
+// send every byte described by 'iov', resuming after partial sends.
+// returns the number of bytes sent, or -1 on error. zeroCopied (if given) tells whether any
+// of it went out MSG_ZEROCOPY, which is dropped once the kernel runs out of notification memory.
+ssize_t IPCSocket::sendmsg_full(int fd, struct iovec *iov, int iovcnt, int flags, bool* zeroCopied) {
+    size_t total_sent = 0;
+    if (zeroCopied != nullptr) {
+        *zeroCopied = false;
+    }
+    while (iovcnt > 0) {
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovcnt;
+        ssize_t res = sendmsg(fd, &msg, flags);
+        if (res < 0) {
+            if (errno == EINTR) continue; // if interrupted by signal, try again
+#ifdef MSG_ZEROCOPY
+            if (errno == ENOBUFS && (flags & MSG_ZEROCOPY)) {
+                // out of optmem for notifications: drain them, or fall back to copying
+                if (zeroCopyCompleted != zeroCopySent) {
+                    reapZeroCopyCompletions(fd, true);
+                } else {
+                    flags &= ~MSG_ZEROCOPY;
+                }
+                continue;
+            }
+#endif
+            return -1; // return error on actual write error
+        }
+#ifdef MSG_ZEROCOPY
+        if (flags & MSG_ZEROCOPY) {
+            ++zeroCopySent; // every successful zerocopy send gets its own notification id
+            if (zeroCopied != nullptr) {
+                *zeroCopied = true;
+            }
+        }
+#endif
+        total_sent += res;
+
+        // skip the iovecs that went out completely, trim the one that went out partially
+        size_t advance = res;
+        while (iovcnt > 0 && advance >= iov->iov_len) {
+            advance -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + advance;
+            iov->iov_len -= advance;
+        }
+    }
+    return total_sent;
+}
+
+void IPCSocket::enableZeroCopy(int fd) {
+#ifdef SO_ZEROCOPY
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &opt, sizeof(opt)) == 0) {
+        return;
+    }
+    perror("setsockopt(SO_ZEROCOPY), falling back to copying sends");
+#endif
+    zeroCopy = false;
+}
+
+// read MSG_ZEROCOPY completion notifications off the socket error queue and unpin the
+// tensors they cover. with 'wait' set, block until every outstanding send has completed.
+void IPCSocket::reapZeroCopyCompletions(int fd, bool wait) {
+#if defined(__linux__) && defined(SO_EE_ORIGIN_ZEROCOPY)
+    while (zeroCopyCompleted != zeroCopySent) {
+        char control[128];
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE) == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (!wait) break;
+                // POLLERR is reported as soon as the error queue is non-empty
+                struct pollfd pfd;
+                pfd.fd = fd;
+                pfd.events = 0;
+                poll(&pfd, 1, -1);
+                continue;
+            }
+            perror("recvmsg(MSG_ERRQUEUE)");
+            break;
+        }
+
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            bool isRecvErr = (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                             (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR);
+            if (!isRecvErr) continue;
+            auto* serr = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cmsg));
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+            // notifications cover the inclusive range of send ids [ee_info, ee_data]
+            zeroCopyCompleted += serr->ee_data - serr->ee_info + 1;
+            if ((serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) && !zeroCopyWasCopied) {
+                zeroCopyWasCopied = true;
+                DEBUG_PRINT(1, "Socket: kernel copied a MSG_ZEROCOPY send (expected on loopback)\n");
+            }
+        }
+    }
+#endif
+    // ids are handed out in order, so everything up to zeroCopyCompleted can go
+    while (!zeroCopyPinned.empty() &&
+           static_cast<int32_t>(zeroCopyCompleted - zeroCopyPinned.front().first) >= 0) {
+        zeroCopyPinned.pop_front();
+    }
+}
+
 void IPCSocket::exitSubprocess() {
     if (childPid == 0) { // child process
         // technically, the child process should exit when it receives the termination signal
@@ -240,13 +617,22 @@ void IPCSocket::exitSubprocess() {
         exit(0); // ensure child exits cleanly
     } else if (childPid > 0) { // parent process
 
+        // results of submitted requests have to be read before the child can be stopped
+        completions.drain();
+        reapZeroCopyCompletions(clientFd, true);
+
         // send termination signal to child
-        int terminationSignal = -25; // -25 is just randomly chosen assuming size will never be negative
+        TensorFrameHeader terminationSignal = {};
+        terminationSignal.terminate = 1;
         write_full(clientFd, reinterpret_cast<char*>(&terminationSignal), sizeof(terminationSignal));
         
         // wait for child process to exit
         int status;
         waitpid(childPid, &status, 0);
+
+        // the rings hold references to the socket until they are torn down
+        sendRing.close();
+        receiveRing.close();
         
         // close client connection
         if (clientFd != -1) {
@@ -261,144 +647,3 @@ void IPCSocket::exitSubprocess() {
         }
     }
 }
-
-
-void IPCSocket::sendAndReceive(int matrixSize) {
-    int server_fd, new_socket, valread;
-    struct sockaddr_in address;
-    int opt = 1;
-    int addrlen = sizeof(address);
-    const int port = 8080;
-
-    // creating socket fd
-    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
-        perror("socket failed");
-        exit(EXIT_FAILURE);
-    }
-
-    // attaching socket to port 8080
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt))) {
-        perror("setsockopt");
-        exit(EXIT_FAILURE);
-    }
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(port);
-
-    // bind the socket to port 8080
-    if (bind(server_fd, (struct sockaddr *)&address,sizeof(address))< 0) {
-        perror("bind failed");
-        exit(EXIT_FAILURE);
-    }
-    if (listen(server_fd, 3) < 0) {
-        perror("listen");
-        exit(EXIT_FAILURE);
-    }
-
-    pid_t pid = fork();
-    if (pid==-1){
-        perror("fork");
-        exit(EXIT_FAILURE);
-    } else if (pid==0) { // child process
-        // connect to the server
-        int sock = 0;
-        struct sockaddr_in serv_addr;
-        if ((sock=socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-            printf("\n Error in socket creation \n");
-            return;
-        }
-        DEBUG_PRINT(1, "Socket: Child created socket\n");
-        serv_addr.sin_family = AF_INET;
-        serv_addr.sin_port = htons(port);
-
-        // convert address from text to binary
-        if (inet_pton(AF_INET, "127.0.0.1", &serv_addr.sin_addr) <= 0){
-            printf("\nInvalid address/ Address not supported \n");
-            return;
-        }
-
-        DEBUG_PRINT(1, "Socket: Child converted Address using inet_pton. Trying to connect...\n");
-        while (connect(sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0){
-            usleep(1000); // sleep for 1ms and then retry
-        }
-
-        // receive the matrix from the server
-        std::vector<char> recv_buf(matrixSize * matrixSize * sizeof(CPP_TENSOR_DTYPE));
-        // read(sock, recv_buf.data(), recv_buf.size());
-        ssize_t bytes_read = read_full(sock, recv_buf.data(), recv_buf.size());
-        DEBUG_PRINT(1, "Socket:Child Read "<<bytes_read<<" bytes\n");
-        
-        if (bytes_read < 0) {
-            perror("read_full failed");
-            exit(EXIT_FAILURE);
-        }
-
-        torch::Tensor matrix = deserializeTensor(recv_buf, {matrixSize, matrixSize});
-        DEBUG_PRINT(1, "Socket: Child completed reading buffer and deserializing\n");
-        // MatrixOperation::printMatrix(matrix);
-        torch::Tensor squared_matrix = MatrixOperation::squareMatrix(matrix);
-
-        DEBUG_PRINT(1, "Socket: Child deserialized and squared matrix\n");
-        // MatrixOperation::printMatrix(squared_matrix);
-        // send the processed matrix back to server
-        auto send_buf = serializeTensor(squared_matrix);
-        // write(sock, send_buf.data(), send_buf.size());
-        ssize_t bytes_written = write_full(sock, send_buf.data(), send_buf.size());
-        DEBUG_PRINT(1, "Socket: Child wrote "<<bytes_written<<" bytes to the socket\n");
-        if (bytes_written < 0) {
-            perror("write_full failed");
-            exit(EXIT_FAILURE);
-        }
-        DEBUG_PRINT(1, "Socket: Child Serialized and and wrote to socket\n");
-        exit(0);
-    } else { //parent process
-        DEBUG_PRINT(1, "Socket: Parent accepting connections\n");
-        if ((new_socket = accept(server_fd, (struct sockaddr *)&address, (socklen_t*)&addrlen)) < 0){
-            perror("accept");
-            exit(EXIT_FAILURE);
-        }
-
-        // send matrix to child
-        torch::Tensor matrix = MatrixOperation::generateRandomMatrix(matrixSize);
-        auto send_buf = serializeTensor(matrix);
-        // write(new_socket, send_buf.data(), send_buf.size());
-        ssize_t bytes_written = write_full(new_socket, send_buf.data(), send_buf.size());
-        if (bytes_written < 0) {
-            perror("write_full failed");
-            exit(EXIT_FAILURE);
-        }
-        DEBUG_PRINT(1, "Socket: Parent wrote "<<bytes_written<<" bytes to the socket\n");
-        // MatrixOperation::printMatrix(matrix);
-
-        std::vector<char>recv_buf(matrixSize * matrixSize * sizeof(CPP_TENSOR_DTYPE));
-        // read(new_socket, recv_buf.data(), recv_buf.size());
-        ssize_t bytes_read = read_full(new_socket, recv_buf.data(), recv_buf.size());
-        if (bytes_read < 0) {
-            perror("read_full failed");
-            exit(EXIT_FAILURE);
-        }
-        DEBUG_PRINT(1, "Socket: Parent read "<<bytes_read<<" from the socket\n");
-
-        // Deserialize the received buffer into a tensor
-        auto result = deserializeTensor(recv_buf, {matrixSize, matrixSize});
-        DEBUG_PRINT(1, "Socket: Parent deserialized the matrix\n");
-        // MatrixOperation::printMatrix(result);
-
-        // Check if the received squared matrix matches the reference squared matrix
-        bool isSquaredCorrectly = MatrixOperation::checkIfSquaredMatrix(matrix, result);
-        if (isSquaredCorrectly) {
-            std::cout << "Socket: The matrix was squared correctly." << std::endl;
-        } else {
-            std::cout << "Socket: The matrix was not squared correctly." << std::endl;
-        }
-
-
-        close(new_socket);
-        close(server_fd);
-
-        // wait for child
-        wait(nullptr);
-    }
-}
-
-
@@ -0,0 +1,137 @@
+#include "IPCSubmissionQueue.h"
+
+IPCSubmissionQueue::IPCSubmissionQueue(std::unique_ptr<IPCMethod> inner) : inner(std::move(inner)) {
+    DEBUG_PRINT(1, "SubmissionQueue: callers share one " << this->inner->methodName() << " channel\n");
+}
+
+IPCSubmissionQueue::~IPCSubmissionQueue() {
+    stopThreads();
+}
+
+void IPCSubmissionQueue::initSubprocess() {
+    inner->initSubprocess();
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = false;
+    dispatchThread = std::thread(&IPCSubmissionQueue::dispatchLoop, this);
+    completeThread = std::thread(&IPCSubmissionQueue::completeLoop, this);
+}
+
+void IPCSubmissionQueue::exitSubprocess() {
+    stopThreads();
+    inner->exitSubprocess();
+}
+
+void IPCSubmissionQueue::stopThreads() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!dispatchThread.joinable()) {
+            return;
+        }
+        changed.wait(lock, [&] { return outstanding == 0; });
+        stopping = true;
+        changed.notify_all();
+    }
+    dispatchThread.join();
+    completeThread.join();
+}
+
+void IPCSubmissionQueue::waitIdle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&] { return outstanding == 0; });
+}
+
+// the only work done on the caller's thread: a queue entry and its completion slot
+std::future<torch::Tensor> IPCSubmissionQueue::submit(const torch::Tensor& matrix) {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&] { return outstanding < maxInFlight(); });
+    queued.emplace_back();
+    Request& request = queued.back();
+    request.matrix = matrix;
+    std::future<torch::Tensor> future = request.slot.get_future();
+    ++outstanding;
+    changed.notify_all();
+    return future;
+}
+
+torch::Tensor IPCSubmissionQueue::sendAndReceiveV2(const torch::Tensor& matrix) {
+    return submit(matrix).get();
+}
+
+size_t IPCSubmissionQueue::outstandingRequests() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return outstanding;
+}
+
+void IPCSubmissionQueue::setOperation(MatrixOp op) {
+    waitIdle();
+    IPCMethod::setOperation(op);
+    inner->setOperation(op);
+}
+
+void IPCSubmissionQueue::setSparseThreshold(double density) {
+    waitIdle();
+    IPCMethod::setSparseThreshold(density);
+    inner->setSparseThreshold(density);
+}
+
+void IPCSubmissionQueue::setLaunchMode(LaunchMode mode) {
+    waitIdle();
+    IPCMethod::setLaunchMode(mode);
+    inner->setLaunchMode(mode);
+}
+
+void IPCSubmissionQueue::setMaxInFlight(size_t window) {
+    waitIdle();
+    IPCMethod::setMaxInFlight(window);
+    inner->setMaxInFlight(window);
+}
+
+// single consumer of the queue. inner->submit() blocks while the inner window is full (or,
+// for transports without a pipelined path, for the whole round trip), which holds the
+// callers back once the queue is full too
+void IPCSubmissionQueue::dispatchLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait(lock, [&] { return !queued.empty() || stopping; });
+        if (queued.empty()) {
+            return; // stopping with nothing queued
+        }
+        Request request = std::move(queued.front());
+        queued.pop_front();
+        lock.unlock();
+        try {
+            request.result = inner->submit(request.matrix);
+        } catch (...) {
+            // handed on through the completer, so requests still complete in order
+            std::promise<torch::Tensor> failed;
+            failed.set_exception(std::current_exception());
+            request.result = failed.get_future();
+        }
+        lock.lock();
+        dispatched.push_back(std::move(request));
+        changed.notify_all();
+    }
+}
+
+// results of one channel come back in the order they were sent, so waiting on the oldest
+// request doesn't hold up one that is already done (behind a worker pool it may, briefly)
+void IPCSubmissionQueue::completeLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait(lock, [&] { return !dispatched.empty() || stopping; });
+        if (dispatched.empty()) {
+            return; // stopping, and the dispatcher only stops with nothing outstanding
+        }
+        Request request = std::move(dispatched.front()); // only this thread pops
+        dispatched.pop_front();
+        lock.unlock();
+        try {
+            request.slot.set_value(request.result.get());
+        } catch (...) {
+            request.slot.set_exception(std::current_exception()); // the caller rethrows it
+        }
+        lock.lock();
+        --outstanding;
+        changed.notify_all();
+    }
+}
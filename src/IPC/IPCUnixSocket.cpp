@@ -0,0 +1,58 @@
+#include "IPCUnixSocket.h"
+#include <iostream>
+#include <unistd.h>
+
+// largest message a seqpacket read/write moves; every payload is split into messages of
+// this size on both sides, so message boundaries always line up with read_full calls
+static const size_t SEQPACKET_MESSAGE_SIZE = 64 * 1024;
+
+IPCUnixSocket::IPCUnixSocket(int socketType) : socketType(socketType) {
+    if (socketType == SOCK_SEQPACKET) {
+        maxMessageSize = SEQPACKET_MESSAGE_SIZE;
+    }
+}
+
+void IPCUnixSocket::initSubprocess() {
+    int fds[2];
+    if (socketpair(AF_UNIX, socketType, 0, fds) == -1) {
+        perror("socketpair");
+        exit(EXIT_FAILURE);
+    }
+
+    if (socketType == SOCK_SEQPACKET) {
+        // make sure a whole message always fits in the send buffer
+        int bufferSize = 4 * SEQPACKET_MESSAGE_SIZE;
+        for (int fd : fds) {
+            if (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize)) < 0) {
+                perror("setsockopt(SO_SNDBUF)");
+            }
+        }
+    }
+
+    if (spawnsWorker()) {
+        closeOnExec(fds[0]);
+        childPid = spawnWorker(methodName(), {{"fd", std::to_string(fds[1])}});
+    } else {
+        childPid = fork();
+    }
+    if (childPid == -1) {
+        perror("fork");
+        close(fds[0]);
+        close(fds[1]);
+        exit(EXIT_FAILURE);
+    } else if (childPid == 0) { // Child process
+        close(fds[0]);
+        clientFd = fds[1];
+        serveClient();
+        exit(0); // ensure child exits cleanly after processing
+    } else {
+        close(fds[1]);
+        clientFd = fds[0];
+        DEBUG_PRINT(1, "UnixSocket: Parent connected to child over socketpair\n");
+    }
+}
+
+void IPCUnixSocket::serveWorker(const ChannelArguments& args) {
+    clientFd = channelNumber(args, "fd");
+    serveClient();
+}
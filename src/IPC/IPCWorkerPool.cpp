@@ -0,0 +1,108 @@
+#include "IPCWorkerPool.h"
+#include <unistd.h>
+
+IPCWorkerPool::IPCWorkerPool(WorkerFactory factory, size_t workerCount) {
+    if (workerCount == 0) {
+        workerCount = defaultWorkerCount();
+    }
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.push_back(factory());
+    }
+    DEBUG_PRINT(1, "WorkerPool: " << workerCount << " " << workers.front()->methodName() << " workers\n");
+}
+
+size_t IPCWorkerPool::defaultWorkerCount() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? static_cast<size_t>(cores) : 1;
+}
+
+void IPCWorkerPool::initSubprocess() {
+    for (auto& worker : workers) {
+        worker->initSubprocess();
+    }
+}
+
+void IPCWorkerPool::exitSubprocess() {
+    for (auto& worker : workers) {
+        worker->exitSubprocess();
+    }
+}
+
+// fewest outstanding requests wins; the scan starts after the last pick so idle workers
+// take turns
+IPCMethod& IPCWorkerPool::leastLoadedWorker() {
+    size_t best = nextWorker % workers.size();
+    size_t bestLoad = workers[best]->outstandingRequests();
+    for (size_t i = 1; i < workers.size() && bestLoad > 0; ++i) {
+        size_t candidate = (nextWorker + i) % workers.size();
+        size_t load = workers[candidate]->outstandingRequests();
+        if (load < bestLoad) {
+            best = candidate;
+            bestLoad = load;
+        }
+    }
+    nextWorker = best + 1;
+    return *workers[best];
+}
+
+torch::Tensor IPCWorkerPool::sendAndReceiveV2(const torch::Tensor& matrix) {
+    return leastLoadedWorker().sendAndReceiveV2(matrix);
+}
+
+std::future<torch::Tensor> IPCWorkerPool::submit(const torch::Tensor& matrix) {
+    IPCMethod& worker = leastLoadedWorker();
+    worker.setMaxInFlight(maxInFlight());
+    return worker.submit(matrix);
+}
+
+size_t IPCWorkerPool::outstandingRequests() {
+    size_t total = 0;
+    for (auto& worker : workers) {
+        total += worker->outstandingRequests();
+    }
+    return total;
+}
+
+void IPCWorkerPool::setSparseThreshold(double density) {
+    IPCMethod::setSparseThreshold(density);
+    for (auto& worker : workers) {
+        worker->setSparseThreshold(density);
+    }
+}
+
+void IPCWorkerPool::setOperation(MatrixOp op) {
+    IPCMethod::setOperation(op);
+    for (auto& worker : workers) {
+        worker->setOperation(op);
+    }
+}
+
+void IPCWorkerPool::setLaunchMode(LaunchMode mode) {
+    IPCMethod::setLaunchMode(mode);
+    for (auto& worker : workers) {
+        worker->setLaunchMode(mode);
+    }
+}
+
+std::vector<pid_t> IPCWorkerPool::workerPids() const {
+    std::vector<pid_t> pids;
+    for (const auto& worker : workers) {
+        auto workerPids = worker->workerPids();
+        pids.insert(pids.end(), workerPids.begin(), workerPids.end());
+    }
+    return pids;
+}
+
+const PhaseStats& IPCWorkerPool::phaseStats() const {
+    mergedPhases.clear();
+    for (const auto& worker : workers) {
+        mergedPhases.merge(worker->phaseStats());
+    }
+    return mergedPhases;
+}
+
+void IPCWorkerPool::resetPhaseStats() {
+    for (auto& worker : workers) {
+        worker->resetPhaseStats();
+    }
+}
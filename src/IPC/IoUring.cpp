@@ -0,0 +1,368 @@
+#include "IoUring.h"
+#include "WaitStrategy.h" // cpuRelax
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__NR_io_uring_setup) && defined(IORING_OFF_SQES)
+#define IPC_HAVE_IO_URING 1
+#endif
+
+static const unsigned RING_ENTRIES = 16;            // transfers per submission; larger batches go in pieces
+static const unsigned SQPOLL_IDLE_MS = 10;          // the kernel thread sleeps after this long without work
+static const int SQPOLL_COMPLETION_SPINS = 1024;   // completion polls before sleeping in io_uring_enter
+static const size_t MAX_TRANSFER = 1 << 30;         // sqe->len is 32 bits
+
+IoUring::~IoUring() {
+    close();
+}
+
+void IoUring::close() {
+    if (staging != nullptr) {
+        munmap(staging, stagingSize);
+    }
+#ifdef IPC_HAVE_IO_URING
+    if (sqes != nullptr) {
+        munmap(sqes, sqesSize);
+    }
+    if (cqRing != nullptr && cqRing != sqRing) {
+        munmap(cqRing, cqRingSize);
+    }
+    if (sqRing != nullptr) {
+        munmap(sqRing, sqRingSize);
+    }
+    if (ringFd != -1) {
+        ::close(ringFd);
+    }
+#endif
+    ringFd = -1;
+    sqpollEnabled = false;
+    fixedFds.clear();
+    sqRing = cqRing = sqes = cqes = nullptr;
+    sqHead = sqTail = sqMask = sqArray = sqFlags = nullptr;
+    cqHead = cqTail = cqMask = nullptr;
+    staging = nullptr;
+    stagingSize = 0;
+    stagingRegistered = false;
+    queued.clear();
+}
+
+bool IoUring::init(IoUringMode mode, const std::vector<int>& fds) {
+    close();
+    if (mode == IO_URING_OFF) {
+        return false;
+    }
+#ifdef IPC_HAVE_IO_URING
+    bool ready = setup(RING_ENTRIES, mode == IO_URING_SQPOLL);
+    if (!ready && mode == IO_URING_SQPOLL) {
+        // older kernels want CAP_SYS_ADMIN for SQPOLL
+        perror("io_uring_setup(IORING_SETUP_SQPOLL), using a plain ring");
+        ready = setup(RING_ENTRIES, false);
+    }
+    if (!ready) {
+        perror("io_uring_setup");
+        return false;
+    }
+    // fixed files skip the fd table lookup and reference counting on every request
+    if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_FILES, fds.data(), fds.size()) == 0) {
+        fixedFds = fds;
+    } else {
+        perror("io_uring_register(IORING_REGISTER_FILES)");
+    }
+    return true;
+#else
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
+bool IoUring::setup(unsigned entries, bool withSqpoll) {
+#ifdef IPC_HAVE_IO_URING
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    if (withSqpoll) {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = SQPOLL_IDLE_MS;
+    }
+    int fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd == -1) {
+        return false;
+    }
+    ringFd = fd;
+    sqpollEnabled = withSqpoll;
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap) {
+        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+    }
+    void* ring = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring == MAP_FAILED) {
+        close();
+        return false;
+    }
+    sqRing = ring;
+    if (singleMmap) {
+        cqRing = sqRing;
+    } else {
+        ring = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring == MAP_FAILED) {
+            close();
+            return false;
+        }
+        cqRing = ring;
+    }
+    sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring == MAP_FAILED) {
+        close();
+        return false;
+    }
+    sqes = ring;
+
+    char* sq = static_cast<char*>(sqRing);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqFlags = reinterpret_cast<unsigned*>(sq + params.sq_off.flags);
+    sqEntries = params.sq_entries;
+    char* cq = static_cast<char*>(cqRing);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = cq + params.cq_off.cqes;
+    return true;
+#else
+    return false;
+#endif
+}
+
+// registered buffers are pinned and count against RLIMIT_MEMLOCK; when registering fails
+// the buffer is still handed out and used with the plain opcodes
+char* IoUring::stagingBuffer(size_t bytes) {
+    if (bytes <= stagingSize) {
+        return staging;
+    }
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t size = (bytes + pageSize - 1) / pageSize * pageSize;
+#ifdef IPC_HAVE_IO_URING
+    if (stagingRegistered) {
+        syscall(__NR_io_uring_register, ringFd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+        stagingRegistered = false;
+    }
+#endif
+    if (staging != nullptr) {
+        munmap(staging, stagingSize);
+    }
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    staging = static_cast<char*>(memory);
+    stagingSize = size;
+#ifdef IPC_HAVE_IO_URING
+    if (ringFd != -1 && bufferRegistration) {
+        struct iovec iov;
+        iov.iov_base = staging;
+        iov.iov_len = stagingSize;
+        if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, &iov, 1) == 0) {
+            stagingRegistered = true;
+        } else {
+            perror("io_uring_register(IORING_REGISTER_BUFFERS)");
+            bufferRegistration = false; // don't retry (and complain) on every regrow
+        }
+    }
+#endif
+    return staging;
+}
+
+void IoUring::queue(int fd, bool write, char* data, size_t length) {
+    if (length > 0) {
+        queued.push_back({fd, write, data, length, 0});
+    }
+}
+
+void IoUring::queueRead(int fd, void* data, size_t length) {
+    queue(fd, false, static_cast<char*>(data), length);
+}
+
+void IoUring::queueWrite(int fd, const void* data, size_t length) {
+    queue(fd, true, const_cast<char*>(static_cast<const char*>(data)), length);
+}
+
+ssize_t IoUring::readFull(int fd, void* data, size_t length) {
+    queueRead(fd, data, length);
+    return transferAll();
+}
+
+ssize_t IoUring::writeFull(int fd, const void* data, size_t length) {
+    queueWrite(fd, data, length);
+    return transferAll();
+}
+
+// every piece of up to RING_ENTRIES transfers is one linked chain: one io_uring_enter submits
+// it and waits for it. a short transfer breaks the chain, so its rest and the transfers
+// behind it come back -ECANCELED and go out again, still in order, in the next round.
+ssize_t IoUring::transferAll() {
+#ifdef IPC_HAVE_IO_URING
+    std::vector<Transfer> batch;
+    batch.swap(queued);
+    if (ringFd == -1) {
+        errno = EBADF;
+        return -1;
+    }
+    ssize_t total = 0;
+    for (size_t first = 0; first < batch.size(); first += sqEntries) {
+        size_t last = std::min(batch.size(), first + sqEntries);
+        while (true) {
+            std::vector<size_t> pending;
+            for (size_t i = first; i < last; ++i) {
+                if (batch[i].done < batch[i].length) {
+                    pending.push_back(i);
+                }
+            }
+            if (pending.empty()) {
+                break;
+            }
+            if (!submitChain(batch, pending)) {
+                return -1;
+            }
+            int error = 0;
+            bool endOfFile = false;
+            for (size_t reaped = 0; reaped < pending.size(); ++reaped) {
+                size_t index;
+                int result;
+                if (!reapCompletion(index, result)) {
+                    return -1;
+                }
+                if (result > 0) {
+                    batch[index].done += result;
+                    total += result;
+                } else if (result == 0 && !batch[index].write) {
+                    endOfFile = true;
+                } else if (result < 0 && result != -ECANCELED && result != -EINTR && result != -EAGAIN) {
+                    error = -result;
+                }
+            }
+            if (error != 0) {
+                errno = error;
+                return -1;
+            }
+            if (endOfFile) {
+                return total;
+            }
+        }
+    }
+    return total;
+#else
+    queued.clear();
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+bool IoUring::submitChain(std::vector<Transfer>& batch, const std::vector<size_t>& pending) {
+#ifdef IPC_HAVE_IO_URING
+    auto* entries = static_cast<struct io_uring_sqe*>(sqes);
+    unsigned tail = *sqTail; // only this thread produces
+    for (size_t k = 0; k < pending.size(); ++k) {
+        Transfer& transfer = batch[pending[k]];
+        char* data = transfer.data + transfer.done;
+        size_t length = std::min(transfer.length - transfer.done, MAX_TRANSFER);
+        bool fixedBuffer = stagingRegistered && data >= staging && data + length <= staging + stagingSize;
+
+        unsigned slot = tail & *sqMask;
+        struct io_uring_sqe* sqe = &entries[slot];
+        std::memset(sqe, 0, sizeof(*sqe));
+        if (transfer.write) {
+            sqe->opcode = fixedBuffer ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        } else {
+            sqe->opcode = fixedBuffer ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        }
+        auto fixed = std::find(fixedFds.begin(), fixedFds.end(), transfer.fd);
+        if (fixed != fixedFds.end()) {
+            sqe->fd = static_cast<int>(fixed - fixedFds.begin());
+            sqe->flags |= IOSQE_FIXED_FILE;
+        } else {
+            sqe->fd = transfer.fd;
+        }
+        if (k + 1 < pending.size()) {
+            sqe->flags |= IOSQE_IO_LINK;
+        }
+        sqe->addr = reinterpret_cast<uint64_t>(data);
+        sqe->len = static_cast<uint32_t>(length);
+        sqe->off = 0; // pipes and sockets have no file position
+        sqe->buf_index = 0;
+        sqe->user_data = pending[k];
+        sqArray[slot] = slot;
+        ++tail;
+    }
+    __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+    unsigned count = static_cast<unsigned>(pending.size());
+    if (sqpollEnabled) {
+        // the kernel thread picks the chain up by itself unless it went to sleep
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(sqFlags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) {
+            if (syscall(__NR_io_uring_enter, ringFd, 0, 0, IORING_ENTER_SQ_WAKEUP, nullptr, 0) == -1) {
+                perror("io_uring_enter");
+                return false;
+            }
+        }
+        return true;
+    }
+    // submit the chain and wait for all of it in the same call
+    unsigned submitted = 0;
+    while (submitted < count) {
+        long result = syscall(__NR_io_uring_enter, ringFd, count - submitted, count, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (result == -1) {
+            if (errno == EINTR) continue;
+            perror("io_uring_enter");
+            return false;
+        }
+        submitted += result;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool IoUring::reapCompletion(size_t& index, int& result) {
+#ifdef IPC_HAVE_IO_URING
+    unsigned head = *cqHead; // only this thread consumes
+    int spins = 0;
+    while (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+        if (sqpollEnabled && spins < SQPOLL_COMPLETION_SPINS) {
+            // with SQPOLL a request needs no syscall at all if the answer comes within the spin
+            ++spins;
+            cpuRelax();
+            continue;
+        }
+        if (syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) == -1 && errno != EINTR) {
+            perror("io_uring_enter");
+            return false;
+        }
+    }
+    const struct io_uring_cqe* cqe = &static_cast<struct io_uring_cqe*>(cqes)[head & *cqMask];
+    index = cqe->user_data;
+    result = cqe->res;
+    __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,101 @@
+#include "PhaseTimer.h"
+
+const char* phaseName(int phase) {
+    switch (phase) {
+    case PHASE_SERIALIZE:   return "serialize";
+    case PHASE_WRITE:       return "write";
+    case PHASE_CHILD_WAKE:  return "child_wake";
+    case PHASE_CHILD_READ:  return "child_read";
+    case PHASE_COMPUTE:     return "compute";
+    case PHASE_CHILD_WRITE: return "child_write";
+    case PHASE_READ:        return "read";
+    case PHASE_DESERIALIZE: return "deserialize";
+    default:                return "unknown";
+    }
+}
+
+void LogLinearHistogram::clear() {
+    std::memset(counts, 0, sizeof(counts));
+    total = 0;
+    sum = 0;
+}
+
+void LogLinearHistogram::record(uint64_t value) {
+    ++counts[bucketIndex(value)];
+    ++total;
+    sum += value;
+}
+
+void LogLinearHistogram::merge(const LogLinearHistogram& other) {
+    for (int i = 0; i < BUCKETS; ++i) {
+        counts[i] += other.counts[i];
+    }
+    total += other.total;
+    sum += other.sum;
+}
+
+uint64_t LogLinearHistogram::percentile(double p) const {
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(p / 100.0 * total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > total) rank = total;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return bucketLowerBound(i);
+        }
+    }
+    return bucketLowerBound(BUCKETS - 1);
+}
+
+// values below SUB_BUCKETS get one bucket each; above that every power of two [2^e, 2^(e+1))
+// is split into SUB_BUCKETS equal buckets
+int LogLinearHistogram::bucketIndex(uint64_t value) {
+    if (value < static_cast<uint64_t>(SUB_BUCKETS)) {
+        return static_cast<int>(value);
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    int sub = static_cast<int>(value >> (exponent - SUB_BUCKET_BITS)) - SUB_BUCKETS;
+    return SUB_BUCKETS + (exponent - SUB_BUCKET_BITS) * SUB_BUCKETS + sub;
+}
+
+uint64_t LogLinearHistogram::bucketLowerBound(int index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    int exponent = (index - SUB_BUCKETS) / SUB_BUCKETS + SUB_BUCKET_BITS;
+    uint64_t sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+    return (SUB_BUCKETS + sub) << (exponent - SUB_BUCKET_BITS);
+}
+
+#ifdef IPC_ENABLE_PHASE_TIMING
+void PhaseStats::clear() {
+    for (auto& histogram : histograms) {
+        histogram.clear();
+    }
+}
+
+void PhaseStats::recordParent(const PhaseTimes& times) {
+    for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+        if (times.ns[phase] > 0) {
+            histograms[phase].record(times.ns[phase]);
+        }
+    }
+}
+
+void PhaseStats::recordChild(const PhaseTimes& times, uint64_t requestStartNs) {
+    recordParent(times);
+    if (times.wakeNs >= requestStartNs) {
+        histograms[PHASE_CHILD_WAKE].record(times.wakeNs - requestStartNs);
+    }
+}
+
+void PhaseStats::merge(const PhaseStats& other) {
+    for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+        histograms[phase].merge(other.histograms[phase]);
+    }
+}
+#endif
@@ -0,0 +1,200 @@
+#include "ProcessCounters.h"
+#include "debug.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+ProcessCounters& ProcessCounters::operator+=(const ProcessCounters& other) {
+    minorFaults += other.minorFaults;
+    majorFaults += other.majorFaults;
+    voluntarySwitches += other.voluntarySwitches;
+    involuntarySwitches += other.involuntarySwitches;
+    return *this;
+}
+
+ProcessCounters ProcessCounters::operator-(const ProcessCounters& other) const {
+    ProcessCounters difference;
+    difference.minorFaults = minorFaults - other.minorFaults;
+    difference.majorFaults = majorFaults - other.majorFaults;
+    difference.voluntarySwitches = voluntarySwitches - other.voluntarySwitches;
+    difference.involuntarySwitches = involuntarySwitches - other.involuntarySwitches;
+    return difference;
+}
+
+ProcessCounters selfCounters() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    ProcessCounters counters;
+    counters.minorFaults = usage.ru_minflt;
+    counters.majorFaults = usage.ru_majflt;
+    counters.voluntarySwitches = usage.ru_nvcsw;
+    counters.involuntarySwitches = usage.ru_nivcsw;
+    return counters;
+}
+
+static std::string procPath(pid_t pid, const char* file) {
+    return pid == 0 ? std::string("/proc/self/") + file : "/proc/" + std::to_string(pid) + "/" + file;
+}
+
+// minflt and majflt are fields 10 and 12 of /proc/<pid>/stat; the command name in field 2
+// may contain spaces, so counting starts behind its closing parenthesis
+static void readStatFaults(pid_t pid, ProcessCounters& counters) {
+    std::ifstream stat(procPath(pid, "stat"));
+    std::string line;
+    if (!std::getline(stat, line)) {
+        return;
+    }
+    size_t end = line.rfind(')');
+    if (end == std::string::npos) {
+        return;
+    }
+    std::istringstream fields(line.substr(end + 1));
+    std::string field;
+    for (int index = 3; fields >> field; ++index) {
+        if (index == 10) {
+            counters.minorFaults += std::strtod(field.c_str(), nullptr);
+        } else if (index == 12) {
+            counters.majorFaults += std::strtod(field.c_str(), nullptr);
+            return;
+        }
+    }
+}
+
+ProcessCounters processCounters(const std::vector<pid_t>& pids) {
+    ProcessCounters counters;
+    for (pid_t pid : pids) {
+        readStatFaults(pid, counters);
+        std::ifstream status(procPath(pid, "status"));
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, 24, "voluntary_ctxt_switches:") == 0) {
+                counters.voluntarySwitches += std::strtod(line.c_str() + 24, nullptr);
+            } else if (line.compare(0, 27, "nonvoluntary_ctxt_switches:") == 0) {
+                counters.involuntarySwitches += std::strtod(line.c_str() + 27, nullptr);
+            }
+        }
+    }
+    return counters;
+}
+
+double statusKb(pid_t pid, const std::string& field) {
+    std::ifstream status(procPath(pid, "status"));
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, field.size() + 1, field + ":") == 0) {
+            return std::strtod(line.c_str() + field.size() + 1, nullptr);
+        }
+    }
+    return 0;
+}
+
+static const char* const PERF_EVENT_NAMES[PERF_EVENT_COUNT] = {
+    "task_clock_us", "context_switches", "cpu_migrations", "minor_faults", "major_faults",
+    "cycles", "instructions", "cache_misses"
+};
+
+const char* perfEventName(int event) {
+    return event >= 0 && event < PERF_EVENT_COUNT ? PERF_EVENT_NAMES[event] : "unknown";
+}
+
+#ifdef __linux__
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} PERF_EVENT_CONFIGS[PERF_EVENT_COUNT] = {
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MIN},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MAJ},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+};
+
+// counting (not sampling) in user and kernel mode, so the copies inside read/write count
+// too; perf_event_paranoid 2 allows that for our own processes
+static int openPerfEvent(int event, pid_t pid) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_EVENT_CONFIGS[event].type;
+    attr.config = PERF_EVENT_CONFIGS[event].config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_hv = 1;
+    int fd = syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+    if (fd == -1 && attr.type == PERF_TYPE_SOFTWARE) {
+        // paranoid 3 and up (some distributions): user mode only may still be allowed
+        attr.exclude_kernel = 1;
+        fd = syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+    }
+    return fd;
+}
+#endif
+
+PerfCounters::PerfCounters(const std::vector<pid_t>& pids) {
+#ifdef __linux__
+    for (int event = 0; event < PERF_EVENT_COUNT; ++event) {
+        for (pid_t pid : pids) {
+            int fd = openPerfEvent(event, pid);
+            if (fd == -1) {
+                DEBUG_PRINT(1, "Perf: " << perfEventName(event) << " unavailable for " << pid << ": " << strerror(errno) << "\n");
+                for (int opened : fds[event]) {
+                    close(opened);
+                }
+                fds[event].clear();
+                break;
+            }
+            fds[event].push_back(fd);
+        }
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+    for (const auto& eventFds : fds) {
+        for (int fd : eventFds) {
+            close(fd);
+        }
+    }
+}
+
+bool PerfCounters::anyAvailable() const {
+    for (int event = 0; event < PERF_EVENT_COUNT; ++event) {
+        if (available(event)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<double> PerfCounters::read() const {
+    std::vector<double> values(PERF_EVENT_COUNT, -1);
+    for (int event = 0; event < PERF_EVENT_COUNT; ++event) {
+        if (!available(event)) {
+            continue;
+        }
+        double total = 0;
+        for (int fd : fds[event]) {
+            uint64_t data[3]; // value, time enabled, time running
+            if (::read(fd, data, sizeof(data)) != sizeof(data)) {
+                continue;
+            }
+            double value = data[0];
+            if (data[2] > 0 && data[2] < data[1]) {
+                value *= static_cast<double>(data[1]) / data[2];
+            }
+            total += value;
+        }
+        values[event] = event == PERF_TASK_CLOCK ? total / 1e3 : total; // the task clock counts ns
+    }
+    return values;
+}
@@ -0,0 +1,104 @@
+#include "SharedTensorArena.h"
+#include <algorithm>
+#include <iterator>
+#include <sys/mman.h>
+
+SharedTensorArena::SharedTensorArena(void* base, size_t capacity, size_t alignment)
+    : state(std::make_shared<State>()) {
+    state->base = static_cast<char*>(base);
+    state->capacity = capacity;
+    state->alignment = alignment;
+    state->freeBlocks[0] = capacity; // the whole region starts out free
+}
+
+torch::Tensor SharedTensorArena::allocateTensor(at::IntArrayRef sizes, torch::ScalarType dtype) {
+    size_t numel = 1;
+    for (auto dim : sizes) {
+        numel *= static_cast<size_t>(dim);
+    }
+    size_t bytes = numel * torch::elementSize(dtype);
+
+    size_t offset;
+    if (!state->allocate(bytes, offset)) {
+        return torch::Tensor();
+    }
+
+    // the deleter keeps the arena state alive until the last tensor is gone
+    std::shared_ptr<State> owner = state;
+    return torch::from_blob(state->base + offset, sizes,
+                            [owner, offset](void*) { owner->release(offset); },
+                            torch::TensorOptions().dtype(dtype));
+}
+
+void SharedTensorArena::adoptMapping(void* addr, size_t length) {
+    state->mappingAddr = addr;
+    state->mappingLength = length;
+}
+
+bool SharedTensorArena::contains(const void* ptr, size_t bytes) const {
+    const char* p = static_cast<const char*>(ptr);
+    return p >= state->base && p + bytes <= state->base + state->capacity;
+}
+
+size_t SharedTensorArena::offsetOf(const void* ptr) const {
+    return static_cast<const char*>(ptr) - state->base;
+}
+
+size_t SharedTensorArena::bytesInUse() const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->bytesInUse;
+}
+
+SharedTensorArena::State::~State() {
+    if (mappingAddr != nullptr) {
+        munmap(mappingAddr, mappingLength);
+    }
+}
+
+bool SharedTensorArena::State::allocate(size_t bytes, size_t& offset) {
+    // round up so every block starts aligned; zero sized tensors still get a block
+    size_t rounded = (std::max<size_t>(bytes, 1) + alignment - 1) / alignment * alignment;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it) {
+        if (it->second < rounded) {
+            continue;
+        }
+        offset = it->first;
+        size_t remaining = it->second - rounded;
+        freeBlocks.erase(it);
+        if (remaining > 0) {
+            freeBlocks[offset + rounded] = remaining;
+        }
+        usedBlocks[offset] = rounded;
+        bytesInUse += rounded;
+        return true;
+    }
+    return false;
+}
+
+void SharedTensorArena::State::release(size_t offset) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto used = usedBlocks.find(offset);
+    if (used == usedBlocks.end()) {
+        return;
+    }
+    size_t size = used->second;
+    usedBlocks.erase(used);
+    bytesInUse -= size;
+
+    // insert and merge with the free neighbours on both sides
+    auto it = freeBlocks.emplace(offset, size).first;
+    auto next = std::next(it);
+    if (next != freeBlocks.end() && it->first + it->second == next->first) {
+        it->second += next->second;
+        freeBlocks.erase(next);
+    }
+    if (it != freeBlocks.begin()) {
+        auto prev = std::prev(it);
+        if (prev->first + prev->second == it->first) {
+            prev->second += it->second;
+            freeBlocks.erase(it);
+        }
+    }
+}
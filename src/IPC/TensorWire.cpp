@@ -0,0 +1,293 @@
+#include "TensorWire.h"
+#include "BufferPool.h"
+#include <algorithm>
+#include <climits>
+#include <iostream>
+#include <string>
+
+WireDtype wireDtypeOf(torch::ScalarType scalarType) {
+    switch (scalarType) {
+    case torch::kFloat32:  return WIRE_FLOAT32;
+    case torch::kFloat64:  return WIRE_FLOAT64;
+    case torch::kFloat16:  return WIRE_FLOAT16;
+    case torch::kBFloat16: return WIRE_BFLOAT16;
+    case torch::kInt8:     return WIRE_INT8;
+    case torch::kUInt8:    return WIRE_UINT8;
+    case torch::kInt16:    return WIRE_INT16;
+    case torch::kInt32:    return WIRE_INT32;
+    case torch::kInt64:    return WIRE_INT64;
+    default:
+        std::cerr << "Error: tensors of type " << c10::toString(scalarType) << " can't be sent." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+torch::ScalarType wireScalarType(uint8_t dtype) {
+    return visitWireDtype(dtype, [](auto tag) {
+        return WireTraits<typename decltype(tag)::type>::scalarType;
+    });
+}
+
+size_t wireElementSize(uint8_t dtype) {
+    return visitWireDtype(dtype, [](auto tag) {
+        return sizeof(typename decltype(tag)::type);
+    });
+}
+
+static const char* const WIRE_DTYPE_NAMES[WIRE_DTYPE_COUNT] = {
+    "float32", "float64", "float16", "bfloat16", "int8", "uint8", "int16", "int32", "int64"
+};
+
+const char* wireDtypeName(uint8_t dtype) {
+    return dtype < WIRE_DTYPE_COUNT ? WIRE_DTYPE_NAMES[dtype] : "unknown";
+}
+
+bool parseWireDtype(const std::string& name, torch::ScalarType& scalarType) {
+    for (int dtype = 0; dtype < WIRE_DTYPE_COUNT; ++dtype) {
+        if (name == WIRE_DTYPE_NAMES[dtype]) {
+            scalarType = wireScalarType(dtype);
+            return true;
+        }
+    }
+    return false;
+}
+
+torch::Tensor wireLayout(const torch::Tensor& tensor) {
+    if (tensor.is_contiguous() || tensor.is_non_overlapping_and_dense()) {
+        return tensor;
+    }
+    return tensor.contiguous();
+}
+
+TensorWireHeader describeTensor(const torch::Tensor& tensor) {
+    if (tensor.dim() > TENSOR_WIRE_MAX_RANK) {
+        std::cerr << "Error: tensors of rank " << tensor.dim() << " can't be sent (at most "
+                  << TENSOR_WIRE_MAX_RANK << ")." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    TensorWireHeader header = {};
+    header.dtype = wireDtypeOf(tensor.scalar_type());
+    header.rank = static_cast<uint8_t>(tensor.dim());
+    header.flags = tensor.is_contiguous() ? TENSOR_WIRE_CONTIGUOUS : 0;
+    for (int dim = 0; dim < header.rank; ++dim) {
+        header.shape[dim] = tensor.size(dim);
+        header.strides[dim] = tensor.stride(dim);
+    }
+    return header;
+}
+
+int64_t wireElements(const TensorWireHeader& header) {
+    int64_t elements = 1;
+    for (int dim = 0; dim < header.rank; ++dim) {
+        elements *= header.shape[dim];
+    }
+    return elements;
+}
+
+// int32 indices start at the next 8 byte boundary behind the values
+static size_t sparseIndexOffset(const TensorWireHeader& header) {
+    return (static_cast<size_t>(header.nnz) * wireElementSize(header.dtype) + 7) / 8 * 8;
+}
+
+size_t wirePayloadBytes(const TensorWireHeader& header) {
+    if (wireSparse(header)) {
+        size_t indices = (header.flags & TENSOR_WIRE_SPARSE_CSR) ? header.nnz + header.shape[0] + 1 : 2 * header.nnz;
+        return sparseIndexOffset(header) + indices * sizeof(int32_t);
+    }
+    return static_cast<size_t>(wireElements(header)) * wireElementSize(header.dtype);
+}
+
+// a strided payload has to cover exactly numel elements, or reading it would run past
+// the bytes that were sent
+bool validWireHeader(const TensorWireHeader& header) {
+    if (header.dtype >= WIRE_DTYPE_COUNT || header.rank > TENSOR_WIRE_MAX_RANK) {
+        return false;
+    }
+    int64_t lastElement = 0;
+    for (int dim = 0; dim < header.rank; ++dim) {
+        if (header.shape[dim] < 0 || header.strides[dim] < 0) {
+            return false;
+        }
+        if (header.shape[dim] > 0) {
+            lastElement += (header.shape[dim] - 1) * header.strides[dim];
+        }
+    }
+    int64_t elements = wireElements(header);
+    if (wireSparse(header)) {
+        return header.rank == 2 && header.nnz >= 0 && header.nnz <= elements &&
+               header.shape[0] < INT32_MAX && header.shape[1] < INT32_MAX;
+    }
+    return (header.flags & TENSOR_WIRE_CONTIGUOUS) || elements == 0 || lastElement + 1 == elements;
+}
+
+torch::Tensor emptyFromWire(const TensorWireHeader& header) {
+    BufferPool& pool = BufferPool::instance();
+    if (wireSparse(header)) {
+        return pool.empty({static_cast<int64_t>(wirePayloadBytes(header))}, torch::kUInt8);
+    }
+    at::IntArrayRef shape(header.shape, header.rank);
+    if (header.flags & TENSOR_WIRE_CONTIGUOUS) {
+        return pool.empty(shape, wireScalarType(header.dtype));
+    }
+    return pool.emptyStrided(shape, at::IntArrayRef(header.strides, header.rank), wireScalarType(header.dtype));
+}
+
+torch::Tensor tensorFromWire(void* payload, const TensorWireHeader& header) {
+    if (wireSparse(header)) {
+        return torch::from_blob(payload, {static_cast<int64_t>(wirePayloadBytes(header))}, torch::kUInt8);
+    }
+    at::IntArrayRef shape(header.shape, header.rank);
+    auto options = torch::TensorOptions().dtype(wireScalarType(header.dtype));
+    if (header.flags & TENSOR_WIRE_CONTIGUOUS) {
+        return torch::from_blob(payload, shape, options);
+    }
+    return torch::from_blob(payload, shape, at::IntArrayRef(header.strides, header.rank), options);
+}
+
+template <typename T>
+static inline bool isZero(T value) {
+    return value == T(0);
+}
+static inline bool isZero(c10::Half value) {
+    return static_cast<float>(value) == 0.0f;
+}
+static inline bool isZero(c10::BFloat16 value) {
+    return static_cast<float>(value) == 0.0f;
+}
+
+double estimateDensity(const torch::Tensor& tensor, int64_t samples) {
+    torch::Tensor dense = wireLayout(tensor);
+    const int64_t elements = dense.numel();
+    if (elements == 0) {
+        return 0;
+    }
+    // any order will do for a density, so the sample walks memory
+    const int64_t step = std::max<int64_t>(1, elements / samples);
+    return visitWireDtype(wireDtypeOf(dense.scalar_type()), [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        const T* data = static_cast<const T*>(dense.data_ptr());
+        int64_t taken = 0, nonzero = 0;
+        for (int64_t i = 0; i < elements; i += step, ++taken) {
+            nonzero += !isZero(data[i]);
+        }
+        return static_cast<double>(nonzero) / taken;
+    });
+}
+
+// CSR or COO, whichever is smaller; undefined when neither beats the dense payload
+template <typename T>
+static torch::Tensor encodeSparse(const torch::Tensor& rowMajor, TensorWireHeader& header) {
+    const int64_t rows = rowMajor.size(0), cols = rowMajor.size(1);
+    const T* data = static_cast<const T*>(rowMajor.data_ptr());
+    int64_t nnz = 0;
+    for (int64_t i = 0; i < rows * cols; ++i) {
+        nnz += !isZero(data[i]);
+    }
+
+    size_t denseBytes = wirePayloadBytes(header);
+    header.nnz = nnz;
+    header.flags = TENSOR_WIRE_CONTIGUOUS | TENSOR_WIRE_SPARSE_CSR;
+    size_t csrBytes = wirePayloadBytes(header);
+    header.flags = TENSOR_WIRE_CONTIGUOUS | TENSOR_WIRE_SPARSE_COO;
+    size_t cooBytes = wirePayloadBytes(header);
+    bool csr = csrBytes <= cooBytes;
+    if (std::min(csrBytes, cooBytes) >= denseBytes) {
+        return torch::Tensor();
+    }
+    header.flags = TENSOR_WIRE_CONTIGUOUS | (csr ? TENSOR_WIRE_SPARSE_CSR : TENSOR_WIRE_SPARSE_COO);
+
+    torch::Tensor payload = emptyFromWire(header);
+    char* out = static_cast<char*>(payload.data_ptr());
+    T* values = reinterpret_cast<T*>(out);
+    int32_t* first = reinterpret_cast<int32_t*>(out + sparseIndexOffset(header));
+    int32_t* second = first + nnz;
+    int64_t stored = 0;
+    for (int64_t row = 0; row < rows; ++row) {
+        if (csr) {
+            second[row] = static_cast<int32_t>(stored); // row offsets
+        }
+        for (int64_t col = 0; col < cols; ++col) {
+            T value = data[row * cols + col];
+            if (isZero(value)) continue;
+            values[stored] = value;
+            if (csr) {
+                first[stored] = static_cast<int32_t>(col);
+            } else {
+                first[stored] = static_cast<int32_t>(row);
+                second[stored] = static_cast<int32_t>(col);
+            }
+            ++stored;
+        }
+    }
+    if (csr) {
+        second[rows] = static_cast<int32_t>(stored);
+    }
+    return payload;
+}
+
+torch::Tensor encodeForWire(const torch::Tensor& tensor, double sparseThreshold, TensorWireHeader& header) {
+    torch::Tensor dense = wireLayout(tensor);
+    header = describeTensor(dense);
+    if (sparseThreshold <= 0 || dense.dim() != 2 || dense.numel() == 0 ||
+        dense.size(0) >= INT32_MAX || dense.size(1) >= INT32_MAX) {
+        return dense;
+    }
+    if (estimateDensity(dense) >= sparseThreshold) {
+        return dense;
+    }
+    torch::Tensor rowMajor = dense.contiguous();
+    TensorWireHeader sparseHeader = describeTensor(rowMajor);
+    torch::Tensor payload = visitWireDtype(sparseHeader.dtype, [&](auto tag) {
+        return encodeSparse<typename decltype(tag)::type>(rowMajor, sparseHeader);
+    });
+    if (!payload.defined()) {
+        return dense;
+    }
+    header = sparseHeader;
+    return payload;
+}
+
+torch::Tensor wireValues(const torch::Tensor& payload, const TensorWireHeader& header) {
+    if (!wireSparse(header)) {
+        return payload;
+    }
+    return torch::from_blob(payload.data_ptr(), {header.nnz}, wireScalarType(header.dtype));
+}
+
+// indices come from the other side of the channel, so the ones out of range are dropped
+template <typename T>
+static torch::Tensor decodeSparse(const torch::Tensor& payload, const TensorWireHeader& header) {
+    const int64_t rows = header.shape[0], cols = header.shape[1], nnz = header.nnz;
+    torch::Tensor dense = BufferPool::instance().empty({rows, cols}, WireTraits<T>::scalarType).zero_();
+    T* out = static_cast<T*>(dense.data_ptr());
+    const char* in = static_cast<const char*>(payload.data_ptr());
+    const T* values = reinterpret_cast<const T*>(in);
+    const int32_t* first = reinterpret_cast<const int32_t*>(in + sparseIndexOffset(header));
+    const int32_t* second = first + nnz;
+    if (header.flags & TENSOR_WIRE_SPARSE_CSR) {
+        for (int64_t row = 0; row < rows; ++row) {
+            int64_t end = std::min<int64_t>(second[row + 1], nnz);
+            for (int64_t k = std::max<int64_t>(second[row], 0); k < end; ++k) {
+                if (first[k] >= 0 && first[k] < cols) {
+                    out[row * cols + first[k]] = values[k];
+                }
+            }
+        }
+    } else {
+        for (int64_t k = 0; k < nnz; ++k) {
+            if (first[k] >= 0 && first[k] < rows && second[k] >= 0 && second[k] < cols) {
+                out[static_cast<int64_t>(first[k]) * cols + second[k]] = values[k];
+            }
+        }
+    }
+    return dense;
+}
+
+torch::Tensor decodeFromWire(const torch::Tensor& payload, const TensorWireHeader& header) {
+    if (!wireSparse(header)) {
+        return payload;
+    }
+    return visitWireDtype(header.dtype, [&](auto tag) {
+        return decodeSparse<typename decltype(tag)::type>(payload, header);
+    });
+}
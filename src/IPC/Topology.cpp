@@ -0,0 +1,176 @@
+#include "Topology.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <sched.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+static int readIntFile(const std::string& path, int fallback) {
+    std::ifstream in(path);
+    int value;
+    return (in >> value) ? value : fallback;
+}
+
+// "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}
+static std::vector<int> parseCpuList(const std::string& text) {
+    std::vector<int> cpus;
+    std::stringstream stream(text);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        if (range.empty()) continue;
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+static std::vector<int> readCpuListFile(const std::string& path) {
+    std::ifstream in(path);
+    std::string text;
+    std::getline(in, text);
+    return text.empty() ? std::vector<int>() : parseCpuList(text);
+}
+
+// id of the highest level cache the cpu has: the lowest cpu sharing it
+static int lastLevelCache(int cpu) {
+    int bestLevel = 0, id = -1;
+    for (int index = 0;; ++index) {
+        std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cache/index" + std::to_string(index);
+        int level = readIntFile(dir + "/level", -1);
+        if (level == -1) break;
+        auto shared = readCpuListFile(dir + "/shared_cpu_list");
+        if (level >= bestLevel && !shared.empty()) {
+            bestLevel = level;
+            id = *std::min_element(shared.begin(), shared.end());
+        }
+    }
+    return id;
+}
+
+std::vector<CpuInfo> readCpuTopology() {
+    std::vector<int> online = readCpuListFile("/sys/devices/system/cpu/online");
+    if (online.empty()) {
+        long count = sysconf(_SC_NPROCESSORS_ONLN);
+        for (int cpu = 0; cpu < count; ++cpu) online.push_back(cpu);
+    }
+
+    // cpu -> node from the node cpulists
+    std::vector<int> nodeOf;
+    for (int node = 0;; ++node) {
+        std::string path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+        std::ifstream probe(path);
+        if (!probe) break;
+        for (int cpu : readCpuListFile(path)) {
+            if (cpu >= static_cast<int>(nodeOf.size())) nodeOf.resize(cpu + 1, -1);
+            nodeOf[cpu] = node;
+        }
+    }
+
+    std::vector<CpuInfo> cpus;
+    for (int cpu : online) {
+        std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology";
+        CpuInfo info;
+        info.cpu = cpu;
+        info.core = readIntFile(dir + "/core_id", cpu);
+        info.package = readIntFile(dir + "/physical_package_id", 0);
+        info.llc = lastLevelCache(cpu);
+        info.node = cpu < static_cast<int>(nodeOf.size()) ? nodeOf[cpu] : -1;
+        cpus.push_back(info);
+    }
+    return cpus;
+}
+
+std::vector<std::string> placementPresetNames() {
+    return {"same-core", "smt-sibling", "same-llc", "cross-socket"};
+}
+
+std::vector<Placement> placementPresets() {
+    std::vector<Placement> presets;
+    auto cpus = readCpuTopology();
+    if (cpus.empty()) {
+        return presets;
+    }
+    const CpuInfo& home = cpus.front();
+
+    auto preset = [&](const std::string& name, auto matches) {
+        Placement placement;
+        placement.name = name;
+        placement.parentCpu = home.cpu;
+        for (const auto& other : cpus) {
+            if (matches(other)) placement.childCpus.push_back(other.cpu);
+        }
+        if (!placement.childCpus.empty()) {
+            presets.push_back(placement);
+        }
+    };
+    auto sameCore = [&](const CpuInfo& other) { return other.package == home.package && other.core == home.core; };
+    auto sameLlc = [&](const CpuInfo& other) {
+        return home.llc != -1 ? other.llc == home.llc : other.package == home.package;
+    };
+
+    preset("same-core", [&](const CpuInfo& other) { return other.cpu == home.cpu; });
+    preset("smt-sibling", [&](const CpuInfo& other) { return other.cpu != home.cpu && sameCore(other); });
+    preset("same-llc", [&](const CpuInfo& other) { return !sameCore(other) && sameLlc(other); });
+    preset("cross-socket", [&](const CpuInfo& other) { return other.package != home.package; });
+    return presets;
+}
+
+std::string Placement::describe() const {
+    std::ostringstream out;
+    out << (name.empty() ? "unpinned" : name);
+    if (parentCpu >= 0) {
+        out << " parent=" << parentCpu;
+    }
+    if (!childCpus.empty()) {
+        out << " children=";
+        for (size_t i = 0; i < childCpus.size(); ++i) {
+            out << (i ? "," : "") << childCpus[i];
+        }
+    }
+    if (numaNode >= 0) {
+        out << " node=" << numaNode;
+    }
+    return out.str();
+}
+
+bool pinToCpu(pid_t pid, int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(pid, sizeof(set), &set) == -1) {
+        perror("sched_setaffinity");
+        return false;
+    }
+    return true;
+}
+
+bool bindMemoryToNode(int node) {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+    // the node mask is an array of words, so any node number fits; the kernel rejects nodes
+    // this machine doesn't have. it ignores the last of the maxnode bits, hence the + 1
+    const int wordBits = sizeof(unsigned long) * 8;
+    std::vector<unsigned long> mask;
+    int mode = MPOL_DEFAULT;
+    if (node >= 0) {
+        mask.assign(node / wordBits + 1, 0);
+        mask[node / wordBits] = 1UL << (node % wordBits);
+        mode = MPOL_BIND;
+    }
+    if (syscall(SYS_set_mempolicy, mode, node >= 0 ? mask.data() : nullptr, node >= 0 ? mask.size() * wordBits + 1 : 0) == -1) {
+        perror("set_mempolicy");
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,164 @@
+#include "WaitStrategy.h"
+#include <algorithm>
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#endif
+
+// bounds of the adaptive spin budget, in polls
+static const int MIN_SPIN_BUDGET = 64;
+static const int MAX_SPIN_BUDGET = 64 * 1024;
+
+const char* waitStrategyName(WaitStrategy strategy) {
+    switch (strategy) {
+    case WAIT_SEMAPHORE:  return "semaphore";
+    case WAIT_BUSY_POLL:  return "busy-poll";
+    case WAIT_SPIN_FUTEX: return "spin-futex";
+    case WAIT_EVENTFD:    return "eventfd";
+    case WAIT_EVENTFD_EPOLL: return "eventfd-epoll";
+    }
+    return "unknown";
+}
+
+#ifdef __linux__
+static long futexWait(std::atomic<uint32_t>* word, uint32_t expected) {
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, nullptr, nullptr, 0);
+}
+
+static long futexWake(std::atomic<uint32_t>* word, int waiters) {
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, waiters, nullptr, nullptr, 0);
+}
+#endif
+
+void SharedSignal::init() {
+    count.store(0, std::memory_order_relaxed);
+    sleepers.store(0, std::memory_order_relaxed);
+}
+
+bool SharedSignal::tryConsume() {
+    uint32_t current = count.load(std::memory_order_acquire);
+    while (current > 0) {
+        if (count.compare_exchange_weak(current, current - 1, std::memory_order_acquire)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// the seq_cst increment and sleepers load pair with the waiter's seq_cst sleepers increment
+// and count check: either the waiter sees the post or the poster sees the waiter
+void SharedSignal::post() {
+    count.fetch_add(1, std::memory_order_seq_cst);
+#ifdef __linux__
+    if (sleepers.load(std::memory_order_seq_cst) > 0) {
+        futexWake(&count, 1);
+    }
+#endif
+}
+
+void SharedSignal::busyWait() {
+    while (!tryConsume()) {
+        cpuRelax();
+    }
+}
+
+void SharedSignal::spinThenFutexWait(int& spinBudget) {
+    spinBudget = std::min(std::max(spinBudget, MIN_SPIN_BUDGET), MAX_SPIN_BUDGET);
+    for (int spins = 0; spins < spinBudget; ++spins) {
+        if (tryConsume()) {
+            if (spins > spinBudget / 2) {
+                spinBudget = std::min(spinBudget * 2, MAX_SPIN_BUDGET); // answered late in the spin
+            }
+            return;
+        }
+        cpuRelax();
+    }
+    // the other side is slow this time: spinning longer would only burn cpu
+    spinBudget = std::max(spinBudget / 2, MIN_SPIN_BUDGET);
+
+    while (!tryConsume()) {
+#ifdef __linux__
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        if (count.load(std::memory_order_seq_cst) == 0) {
+            // returns at once (EAGAIN) when a post slipped in before the kernel checked the word
+            if (futexWait(&count, 0) == -1 && errno != EAGAIN && errno != EINTR) {
+                perror("futex(FUTEX_WAIT)");
+            }
+        }
+        sleepers.fetch_sub(1, std::memory_order_seq_cst);
+#else
+        sched_yield();
+#endif
+    }
+}
+
+void EventSignal::create(bool nonBlocking) {
+#ifdef __linux__
+    fd = eventfd(0, EFD_SEMAPHORE | (nonBlocking ? EFD_NONBLOCK : 0));
+    if (fd == -1) {
+        perror("eventfd");
+        exit(EXIT_FAILURE);
+    }
+#else
+    fprintf(stderr, "eventfd is only available on Linux\n");
+    exit(EXIT_FAILURE);
+#endif
+}
+
+void EventSignal::post() {
+    uint64_t one = 1;
+    while (write(fd, &one, sizeof(one)) == -1) {
+        if (errno != EINTR) {
+            perror("write(eventfd)");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void EventSignal::wait() {
+    uint64_t value;
+    while (read(fd, &value, sizeof(value)) == -1) {
+        if (errno != EINTR) {
+            perror("read(eventfd)");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// the eventfd is level triggered in the set, so a post that arrived before epoll_wait
+// returns at once; the read can still miss (EAGAIN) when the set also wakes for other fds
+void EventSignal::waitWithEpoll(int epollFd) {
+#ifdef __linux__
+    uint64_t value;
+    while (true) {
+        struct epoll_event event;
+        if (epoll_wait(epollFd, &event, 1, -1) == -1 && errno != EINTR) {
+            perror("epoll_wait");
+            exit(EXIT_FAILURE);
+        }
+        if (read(fd, &value, sizeof(value)) == sizeof(value)) {
+            return;
+        }
+        if (errno != EAGAIN && errno != EINTR) {
+            perror("read(eventfd)");
+            exit(EXIT_FAILURE);
+        }
+    }
+#else
+    wait();
+#endif
+}
+
+void EventSignal::close() {
+    if (fd != -1) {
+        ::close(fd);
+        fd = -1;
+    }
+}
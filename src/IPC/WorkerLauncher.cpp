@@ -0,0 +1,92 @@
+#include "WorkerLauncher.h"
+#include "ElementwiseKernels.h"
+#include "debug.h"
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+
+extern char** environ;
+
+const char* launchModeName(LaunchMode mode) {
+    return mode == LAUNCH_SPAWN ? "spawn" : "fork";
+}
+
+bool parseLaunchMode(const std::string& name, LaunchMode& mode) {
+    if (name == "fork") {
+        mode = LAUNCH_FORK;
+    } else if (name == "spawn") {
+        mode = LAUNCH_SPAWN;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string channelArgument(const ChannelArguments& args, const std::string& key) {
+    auto it = args.find(key);
+    if (it == args.end()) {
+        std::cerr << "IPCWorker: missing channel argument " << key << "=" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return it->second;
+}
+
+long channelNumber(const ChannelArguments& args, const std::string& key) {
+    std::string text = channelArgument(args, key);
+    char* end = nullptr;
+    long value = std::strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0') {
+        std::cerr << "IPCWorker: channel argument " << key << "=" << text << " is not a number" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return value;
+}
+
+std::string workerBinaryPath() {
+    const char* configured = getenv("IPC_WORKER_PATH");
+    if (configured != nullptr && configured[0] != '\0') {
+        return configured;
+    }
+    char self[4096];
+    ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (length <= 0) {
+        return "IPCWorker";
+    }
+    std::string path(self, length);
+    return path.substr(0, path.rfind('/') + 1) + "IPCWorker";
+}
+
+pid_t spawnWorker(const std::string& transport, ChannelArguments args) {
+    args["kernel"] = kernelIsaName(kernelIsa());
+
+    std::string binary = workerBinaryPath();
+    std::vector<std::string> words{binary, transport};
+    for (const auto& arg : args) {
+        words.push_back(arg.first + "=" + arg.second);
+    }
+    std::vector<char*> argv;
+    for (auto& word : words) {
+        argv.push_back(&word[0]);
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid;
+    int error = posix_spawn(&pid, binary.c_str(), nullptr, nullptr, argv.data(), environ);
+    if (error != 0) {
+        std::cerr << "posix_spawn " << binary << ": " << strerror(error)
+                  << " (build the IPCWorker target or set IPC_WORKER_PATH)" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    DEBUG_PRINT(1, "Launcher: Spawned " << binary << " for " << transport << " as " << pid << "\n");
+    return pid;
+}
+
+void closeOnExec(int fd) {
+    int flags = fcntl(fd, F_GETFD);
+    if (flags == -1 || fcntl(fd, F_SETFD, flags | FD_CLOEXEC) == -1) {
+        perror("fcntl(FD_CLOEXEC)");
+    }
+}
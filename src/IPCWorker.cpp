@@ -0,0 +1,41 @@
+#include "ElementwiseKernels.h"
+#include "IPCFactory.h"
+#include "WorkerLauncher.h"
+#include <iostream>
+
+// lean child started by spawnWorker: IPCWorker <transport> key=value ...
+// it starts from a fresh image instead of a copy of the parent, so it carries none of the
+// parent's tensors, thread pools or page tables, and attaches to the channel it is told about
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " TRANSPORT [key=value ...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    ChannelArguments args;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t separator = arg.find('=');
+        if (separator == std::string::npos) {
+            std::cerr << "IPCWorker: expected key=value, got " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+        args[arg.substr(0, separator)] = arg.substr(separator + 1);
+    }
+
+    KernelIsa cap = KERNEL_AVX512;
+    auto kernel = args.find("kernel");
+    if (kernel != args.end() && !parseKernelIsa(kernel->second, cap)) {
+        std::cerr << "IPCWorker: unknown kernel " << kernel->second << std::endl;
+        return EXIT_FAILURE;
+    }
+    setKernelIsa(cap);
+
+    std::unique_ptr<IPCMethod> method = createIPCMethod(argv[1]);
+    if (!method) {
+        std::cerr << "IPCWorker: unknown transport " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+    method->serveWorker(args);
+    // like a forked child: leave without the destructor, the channel belongs to the parent
+    exit(0);
+}
@@ -1,16 +1,34 @@
 #include "MatrixOperation.h"
+#include "ElementwiseKernels.h"
+#include <algorithm>
 
 torch::Tensor MatrixOperation::generateRandomMatrix(int size) {
     return torch::rand({size, size});
 }
 
+void MatrixOperation::fillRandomMatrix(torch::Tensor& matrix) {
+    if (matrix.is_floating_point()) {
+        matrix.uniform_(0, 1);
+    } else {
+        // small enough that the square fits every integer type, int8 included
+        matrix.random_(0, 12);
+    }
+}
+
+void MatrixOperation::sparsifyMatrix(torch::Tensor& matrix, double density) {
+    if (density >= 1) {
+        return;
+    }
+    matrix.masked_fill_(torch::rand(matrix.sizes()).ge(density), 0);
+}
+
 torch::Tensor MatrixOperation::squareMatrix(const torch::Tensor& matrix) {
     return matrix.square();
 }
 
 bool MatrixOperation::checkIfSquaredMatrix(const torch::Tensor& original, const torch::Tensor& squared) {
     // check if the shapes of the two tensors are identical
-    if (original.sizes() != squared.sizes()) {
+    if (original.sizes() != squared.sizes() || original.scalar_type() != squared.scalar_type()) {
         return false;
     }
     
@@ -23,6 +41,180 @@ bool MatrixOperation::checkIfSquaredMatrix(const torch::Tensor& original, const
     return isClose;
 }
 
+// result against the op computed here. integer results must match exactly (they wrap the
+// same way on both sides); floating point ones within a relative tolerance that the half
+// precision types get ten times looser, since the child may sum in another order
+static bool matchesReference(const torch::Tensor& expected, const torch::Tensor& result, double rtol) {
+    if (expected.sizes() != result.sizes() || expected.scalar_type() != result.scalar_type()) {
+        return false;
+    }
+    if (!expected.is_floating_point()) {
+        return torch::equal(expected, result);
+    }
+    if (expected.scalar_type() == torch::kFloat16 || expected.scalar_type() == torch::kBFloat16) {
+        rtol = std::max(rtol * 10, 1e-2);
+    }
+    return torch::allclose(expected, result, rtol, 1e-4);
+}
+
+static std::vector<int64_t> sameShape(at::IntArrayRef sizes) {
+    return sizes.vec();
+}
+
+static double perElement(at::IntArrayRef sizes) {
+    double elements = 1;
+    for (int64_t size : sizes) {
+        elements *= size;
+    }
+    return elements;
+}
+
+// terms of the chain; every one costs an add and a multiply
+#define CHAIN_DEGREE 8
+
+template <typename T>
+static void chainLoop(const T* in, T* out, int64_t count) {
+    for (int64_t i = 0; i < count; ++i) {
+        T x = in[i];
+        T result = x;
+        for (int term = 1; term < CHAIN_DEGREE; ++term) {
+            result = static_cast<T>((result + static_cast<T>(1)) * x);
+        }
+        out[i] = result;
+    }
+}
+
+static void chainElements(const void* in, void* out, int64_t count, uint8_t dtype) {
+    visitWireDtype(dtype, [&](auto tag) {
+        using T = typename decltype(tag)::type;
+        chainLoop(static_cast<const T*>(in), static_cast<T*>(out), count);
+    });
+}
+
+// the same steps as chainLoop, one tensor op each
+static torch::Tensor chainMatrix(const torch::Tensor& matrix) {
+    torch::Tensor result = matrix.clone();
+    for (int term = 1; term < CHAIN_DEGREE; ++term) {
+        result = (result + 1) * matrix;
+    }
+    return result;
+}
+
+static bool verifyChain(const torch::Tensor& original, const torch::Tensor& result) {
+    return matchesReference(chainMatrix(original), result, 1e-5);
+}
+
+static double chainFlops(at::IntArrayRef sizes) {
+    return 2.0 * (CHAIN_DEGREE - 1) * perElement(sizes);
+}
+
+// summed in the matrix's own dtype, so integer rows wrap instead of widening to int64
+static torch::Tensor rowSum(const torch::Tensor& matrix) {
+    return matrix.sum({-1}, true, matrix.scalar_type());
+}
+
+static bool verifyRowSum(const torch::Tensor& original, const torch::Tensor& result) {
+    return matchesReference(rowSum(original), result, 1e-4);
+}
+
+static std::vector<int64_t> rowSumShape(at::IntArrayRef sizes) {
+    std::vector<int64_t> shape = sizes.vec();
+    shape.back() = 1;
+    return shape;
+}
+
+static torch::Tensor matmulTransposed(const torch::Tensor& matrix) {
+    return matrix.mm(matrix.t());
+}
+
+static bool verifyMatmul(const torch::Tensor& original, const torch::Tensor& result) {
+    return matchesReference(matmulTransposed(original), result, 1e-4);
+}
+
+static std::vector<int64_t> gramShape(at::IntArrayRef sizes) {
+    return {sizes[0], sizes[0]};
+}
+
+static double matmulFlops(at::IntArrayRef sizes) {
+    return 2.0 * sizes[0] * sizes[0] * sizes[1];
+}
+
+// small enough for every integer type, and the same on both sides without sending it
+static torch::Tensor gemmBias(const torch::Tensor& matrix) {
+    torch::Tensor bias = torch::arange(matrix.size(0), torch::kInt64).remainder(8).to(matrix.scalar_type());
+    return torch::addmm(bias, matrix, matrix.t());
+}
+
+static bool verifyGemmBias(const torch::Tensor& original, const torch::Tensor& result) {
+    return matchesReference(gemmBias(original), result, 1e-4);
+}
+
+static double gemmBiasFlops(at::IntArrayRef sizes) {
+    return matmulFlops(sizes) + static_cast<double>(sizes[0]) * sizes[0];
+}
+
+// indexed by MatrixOp; matmul and gemm take 2-D matrices
+static const MatrixOpInfo OPERATIONS[OP_COUNT] = {
+    {"square", squareElements, MatrixOperation::squareMatrix, MatrixOperation::checkIfSquaredMatrix, sameShape, perElement},
+    {"chain", chainElements, chainMatrix, verifyChain, sameShape, chainFlops},
+    {"rowsum", nullptr, rowSum, verifyRowSum, rowSumShape, perElement},
+    {"matmul", nullptr, matmulTransposed, verifyMatmul, gramShape, matmulFlops},
+    {"gemm_bias", nullptr, gemmBias, verifyGemmBias, gramShape, gemmBiasFlops},
+};
+
+const MatrixOpInfo& MatrixOperation::operation(uint8_t op) {
+    if (op >= OP_COUNT) {
+        std::cerr << "Error: Unknown matrix operation " << static_cast<int>(op) << "." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return OPERATIONS[op];
+}
+
+bool MatrixOperation::parseOperation(const std::string& name, MatrixOp& op) {
+    for (int candidate = 0; candidate < OP_COUNT; ++candidate) {
+        if (name == OPERATIONS[candidate].name) {
+            op = static_cast<MatrixOp>(candidate);
+            return true;
+        }
+    }
+    return false;
+}
+
+double MatrixOperation::arithmeticIntensity(MatrixOp op, at::IntArrayRef sizes, size_t elementSize) {
+    const MatrixOpInfo& info = operation(op);
+    double bytes = (perElement(sizes) + perElement(info.resultShape(sizes))) * elementSize;
+    return bytes > 0 ? info.flops(sizes) / bytes : 0;
+}
+
+torch::Tensor MatrixOperation::applyPayload(const torch::Tensor& payload, TensorWireHeader& header) {
+    const MatrixOpInfo& op = operation(header.op);
+    if (op.elementwise()) {
+        int64_t values = wireSparse(header) ? header.nnz : wireElements(header);
+        op.elements(payload.data_ptr(), payload.data_ptr(), values, header.dtype);
+        return payload;
+    }
+    torch::Tensor result = wireLayout(op.apply(decodeFromWire(payload, header)));
+    uint8_t requested = header.op;
+    header = describeTensor(result);
+    header.op = requested;
+    return result;
+}
+
+void MatrixOperation::applyPayloadChunk(void* chunk, size_t offset, size_t bytes, const TensorWireHeader& header) {
+    const MatrixOpInfo& op = operation(header.op);
+    if (!op.elementwise()) {
+        std::cerr << "Error: " << op.name << " needs the whole matrix, not a chunk of it." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    size_t elementSize = wireElementSize(header.dtype);
+    size_t valueBytes = wireSparse(header) ? header.nnz * elementSize : wirePayloadBytes(header);
+    if (offset >= valueBytes) {
+        return; // indices
+    }
+    int64_t count = std::min(bytes, valueBytes - offset) / elementSize;
+    op.elements(chunk, chunk, count, header.dtype);
+}
+
 void MatrixOperation::printMatrix(const torch::Tensor& matrix) {
     std::cout << matrix << std::endl;
 }
\ No newline at end of file